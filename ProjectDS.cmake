@@ -4,6 +4,14 @@ add_executable(ProjectDS
         src/decima/archive/archive_manager.cpp
         src/decima/archive/archive_tree.cpp
         src/decima/archive/archive_file.cpp
+        src/decima/archive/archive_snapshot.cpp
+        src/decima/archive/archive_extract.cpp
+        src/decima/archive/archive_writer.cpp
+        src/decima/archive/archive_cipher.cpp
+        src/decima/archive/chunk_cache.cpp
+        src/decima/archive/file_cache.cpp
+        src/decima/archive/file_index.cpp
+        src/decima/archive/object_index.cpp
         src/utils.cpp
         src/app.cpp
         src/projectds_app.cpp
@@ -33,7 +41,9 @@ add_executable(ProjectDS
         src/decima/serializable/object/resource/primitive_resource.cpp
         src/decima/serializable/object/resource/primitive_resource_draw.cpp)
 
-target_link_libraries(ProjectDS PRIVATE hash imgui glfw glad)
+find_package(Threads REQUIRED)
+
+target_link_libraries(ProjectDS PRIVATE hash imgui glfw glad Threads::Threads ${CMAKE_DL_LIBS})
 target_include_directories(ProjectDS PRIVATE include)
 
 if (MSVC)
@@ -3,9 +3,11 @@
 #include <unordered_map>
 #include <vector>
 #include <memory>
-#include <fstream>
 
+#include "decima/archive/archive_cipher.hpp"
 #include "decima/archive/archive_file.hpp"
+#include "util/mapped_file.hpp"
+#include "util/thread_pool.hpp"
 
 namespace Decima {
     enum class ArchiveType : uint32_t {
@@ -67,19 +69,28 @@ namespace Decima {
     public:
         explicit Archive(const std::string& path);
 
+        /** Returns half-open range of chunk entry indices that cover given span of decompressed data, which is empty for an empty span */
+        [[nodiscard]] std::pair<std::size_t, std::size_t> chunk_range(std::uint64_t offset, std::uint64_t size) const;
+
         Decima::ArchiveHeader header {};
         std::vector<Decima::ArchiveFileEntry> file_entries;
         std::vector<Decima::ArchiveChunkEntry> chunk_entries;
+        /** Keys of the chunk entries with the same index, present only in encrypted archives */
+        std::vector<Decima::ChunkKey> chunk_keys;
         std::string path;
+        /**
+         * Priority of the layer this archive belongs to. Files of archives with higher priority override
+         * files with the same hash from archives with lower priority, e.g. patches override base archives.
+         */
+        int priority { 0 };
 
     private:
         friend class ArchiveManager;
         friend class CoreFile;
 
-        bool open();
+        bool open(ash::thread_pool& workers);
 
-        std::unordered_map<std::uint64_t, Decima::CoreFile> m_cache;
-        std::unordered_map<std::uint64_t, std::uint64_t> m_hash_to_index;
-        std::unique_ptr<std::ifstream> m_file;
+        std::vector<std::uint32_t> m_chunk_index;
+        ash::mapped_file m_file;
     };
 }
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Decima {
+    class ArchiveChunkEntry;
+
+    /** Digest that contents of a single chunk are XOR-ed with */
+    using ChunkKey = std::array<std::uint8_t, 16>;
+
+    /** Derives key used to decrypt contents of given (already decrypted) chunk entry */
+    ChunkKey derive_chunk_key(const ArchiveChunkEntry& chunk);
+
+    /** Decrypts [size] bytes from [src] into [dst] using given chunk key. Buffers may be the same */
+    void decrypt_chunk(const void* src, void* dst, std::size_t size, const ChunkKey& key);
+
+    /** Decrypts 32 bytes of the header or a table entry in place using given pair of keys */
+    void decrypt_block(void* data, std::uint32_t key_1, std::uint32_t key_2);
+
+    /**
+     * Decrypts [count] consecutive 32-byte table entries in place. Each entry is
+     * encrypted with a pair of keys it stores itself at given byte offsets, which
+     * are left intact.
+     */
+    void decrypt_table(void* entries, std::size_t count, std::size_t key_1_offset, std::size_t key_2_offset);
+}
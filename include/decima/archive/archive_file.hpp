@@ -1,8 +1,22 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
+#include "decima/serializable/guid.hpp"
+#include "util/buffer.hpp"
+
+namespace ash {
+    class arena;
+    class mapped_file;
+}
+
 namespace Decima {
     class Archive;
     class ArchiveManager;
@@ -10,24 +24,100 @@ namespace Decima {
     class CoreObject;
     class Ref;
 
+    /** Object of a file as seen from its header, known before the object itself is parsed */
+    struct CoreObjectInfo {
+        /** Hash of the type of the object */
+        std::uint64_t type;
+        /** Unique identifier of the object */
+        GUID guid;
+        /** Offset of the header of the object from the start of the file, in bytes */
+        std::size_t offset;
+        /** Size of the object including its header, in bytes */
+        std::size_t size;
+    };
+
+    using CoreObjectFilter = std::function<bool(const CoreObjectInfo&)>;
+
     class CoreFile {
     public:
-        CoreFile(Archive& archive, ArchiveManager& manager, ArchiveFileEntry& entry, std::ifstream& source);
+        /** Unpacks contents of the file; the archive is not kept, since archives move as more of them are loaded */
+        CoreFile(const Archive& archive, ArchiveManager& manager, ArchiveFileEntry& entry, const ash::mapped_file& source);
+
+        CoreFile(const CoreFile&) = delete;
+        CoreFile& operator=(const CoreFile&) = delete;
 
+        ~CoreFile();
+
+        /**
+         * Parses objects of this file (only once) and resolves pending references.
+         * Safe to call from multiple threads; references to other files are resolved
+         * after this file is unlocked, so files referencing each other can't deadlock.
+         * Once it returns, references of this file are resolved even if another thread
+         * was parsing it at the same time.
+         */
         void parse();
 
+        /** Parses only objects that pass given filter, along with objects they reference, see parse() */
+        void parse(const CoreObjectFilter& filter);
+
+        /**
+         * Reads headers of all objects of this file without parsing them (only once),
+         * and returns the table of objects. Safe to call from multiple threads.
+         */
+        const std::vector<CoreObjectInfo>& index_objects();
+
+        /**
+         * Returns object with given index in the table of objects. If it's not parsed yet, parses it
+         * along with objects it references, which may take a while, so the UI does it on the worker pool.
+         */
+        [[nodiscard]] std::shared_ptr<CoreObject> object(std::size_t index);
+
+        /** Object that is being parsed on this thread, e.g. owner of the references being parsed */
+        [[nodiscard]] static const std::shared_ptr<CoreObject>& current_object() noexcept;
+
+        /** Approximate amount of memory occupied by contents and parsed objects of this file, in bytes */
+        [[nodiscard]] std::size_t memory_usage() const;
+
+        /** Hashes of files whose objects are targets of resolved references from this file */
+        [[nodiscard]] std::vector<std::uint64_t> dependencies() const;
+
+        /** Registers a reference parsed from an object of this file, safe to call from handlers parsed in parallel */
         void queue_reference(Ref*);
-        void resolve_reference(const std::shared_ptr<CoreObject>&);
-        void resolve_reference(const CoreFile&);
 
     private:
-        Archive& archive;
         ArchiveManager& manager;
         ArchiveFileEntry& entry;
 
+        void parse(const CoreObjectFilter& filter, bool wait);
+        /* Resolves references after objects were parsed, unlocks the file */
+        void finish_parse(std::unique_lock<std::mutex>& lock, bool parsed, bool wait);
+        void resolve_external_references(const std::vector<Ref*>& external_references);
+        void finish_resolving();
+
+        /* These must be called with the file locked */
+        void read_object_table();
+        bool parse_object(std::size_t index, const std::shared_ptr<ash::arena>& arena);
+        bool parse_objects(const std::vector<std::size_t>& indices);
+        bool resolve_references();
+
+        std::mutex m_mutex;
+        std::condition_variable m_resolved;
+        bool m_resolving { false };
+        std::atomic<bool> m_parsed { false };
+        std::shared_ptr<ash::arena> m_arena;
+        std::atomic<std::size_t> m_batch_arenas_size { 0 };
+        std::vector<CoreObjectInfo> m_object_table;
+        std::unordered_map<GUID, std::size_t> m_object_indices;
+        std::vector<std::shared_ptr<CoreObject>> m_objects;
+        std::vector<Ref*> m_owned_references;
+        std::vector<Ref*> m_external_references;
+
+        mutable std::mutex m_dependencies_mutex;
+        std::vector<std::uint64_t> m_dependencies;
+
     public:
-        std::vector<char> contents;
-        std::vector<std::pair<std::shared_ptr<CoreObject>, std::size_t>> objects;
+        ash::shared_buffer contents;
+        /** References to objects of this file that are waiting to be resolved */
         std::vector<Ref*> references;
     };
 }
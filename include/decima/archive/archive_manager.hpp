@@ -1,28 +1,90 @@
 #pragma once
 
+#include <functional>
+#include <future>
 #include <unordered_map>
 #include <memory>
+#include <vector>
 
 #include "decima/archive/archive.hpp"
+#include "decima/archive/chunk_cache.hpp"
+#include "decima/archive/file_cache.hpp"
+#include "decima/archive/file_index.hpp"
+#include "decima/archive/object_index.hpp"
 #include "decima/serializable/object/prefetch.hpp"
 #include "decima/shared.hpp"
 #include "util/compressor.hpp"
+#include "util/thread_pool.hpp"
 
 namespace Decima {
     class CoreFile;
 
+    /*
+     * Archives and the prefetch must be loaded before any queries are made.
+     * After that, query_file and get_file_entry may be called from any number
+     * of threads at once: archives are read through their mappings, and both
+     * chunk and file caches are guarded by their own locks.
+     */
     class ArchiveManager {
     public:
-        void load_archive(const std::string& path);
+        void load_archive(const std::string& path, int priority = 0);
+
+        /**
+         * Opens and reads tables of all given archives at once on the worker pool.
+         * Archives are added in the order they are given, regardless of which one was read first.
+         * Archives that can't be opened, e.g. ones of unknown types, are logged and skipped.
+         *
+         * All archives are loaded into the layer with given priority. When several archives contain a file
+         * with the same hash, the one with the highest priority wins, and among archives of the same layer,
+         * the one that was loaded first wins.
+         */
+        void load_archives(const std::vector<std::string>& paths, int priority = 0);
         void load_prefetch();
 
-        [[nodiscard]] Decima::OptionalRef<Decima::CoreFile> query_file(std::uint64_t hash);
-        [[nodiscard]] Decima::OptionalRef<Decima::CoreFile> query_file(const std::string& name);
+        /**
+         * Restores archives, the file index, names and the prefetch from the snapshot written by save_snapshot
+         * instead of reading them from archives. Returns false if there's no snapshot, or if it was made for
+         * different archives or a different version of them, in which case nothing is loaded. Must be called
+         * before any archives are loaded, throws std::runtime_error otherwise.
+         */
+        bool load_snapshot(const std::string& path, const std::vector<std::string>& archive_paths);
+
+        /** Writes snapshot of everything load_snapshot restores, must be called after archives and the prefetch are loaded */
+        void save_snapshot(const std::string& path) const;
+
+        /**
+         * Returns handle to the file which stays valid regardless of what other threads do, or nullptr if no such file.
+         * The file is kept in the cache for as long as the handle is alive. Bulk exports should use extract_files
+         * instead, so the files they touch only once don't push out the ones that are actually used.
+         */
+        [[nodiscard]] std::shared_ptr<Decima::CoreFile> query_file(std::uint64_t hash);
+        [[nodiscard]] std::shared_ptr<Decima::CoreFile> query_file(const std::string& name);
+
+        /**
+         * Reads [length] bytes at [offset] of the file, decrypting and decompressing only chunks that overlap them.
+         * The file itself is never cached. Returns empty buffer if there's no such file, and throws
+         * std::out_of_range if the range is outside of the file.
+         */
+        [[nodiscard]] ash::shared_buffer read_range(std::uint64_t hash, std::uint64_t offset, std::uint64_t length);
+        [[nodiscard]] ash::shared_buffer read_range(const std::string& name, std::uint64_t offset, std::uint64_t length);
+
+        /** Reads, decrypts, decompresses and optionally parses the file on the worker pool */
+        [[nodiscard]] std::future<std::shared_ptr<Decima::CoreFile>> query_file_async(std::uint64_t hash, bool parse = false);
+        [[nodiscard]] std::future<std::shared_ptr<Decima::CoreFile>> query_file_async(const std::string& name, bool parse = false);
+        [[nodiscard]] std::vector<std::future<std::shared_ptr<Decima::CoreFile>>> query_files_async(const std::vector<std::uint64_t>& hashes, bool parse = false);
+
+        /**
+         * Reads contents of all given files in bulk, bypassing both caches, and calls [callback] with every file once it's ready.
+         * Reads are batched and kept in flight at once, and files are decrypted and decompressed on the worker pool as their
+         * chunks arrive, so [callback] is called in any order and from any thread. Must not be called from the worker pool.
+         */
+        void extract_files(const std::vector<std::uint64_t>& hashes, const std::function<void(std::uint64_t hash, const ash::shared_buffer& contents)>& callback);
 
         [[nodiscard]] Decima::OptionalRef<Decima::ArchiveFileEntry> get_file_entry(std::uint64_t hash);
         [[nodiscard]] Decima::OptionalRef<Decima::ArchiveFileEntry> get_file_entry(const std::string& name);
 
-        std::unordered_map<uint64_t, uint32_t> hash_to_archive_index;
+        /** Locations of files in all loaded archives. If several archives contain the same file, the one from the highest layer is used */
+        Decima::FileIndex file_index;
 
         // TODO: GUI-related, must be removed
         std::unordered_map<std::uint64_t, std::string> hash_to_name;
@@ -30,6 +92,22 @@ namespace Decima {
 
         std::vector<Archive> archives;
         std::unique_ptr<Decima::Compressor> compressor;
+        /** Files that define objects, for objects of all files in memory. Declared before the file cache, so it outlives cached files */
+        std::unique_ptr<Decima::ObjectIndex> object_index { std::make_unique<Decima::ObjectIndex>() };
+        std::unique_ptr<Decima::ChunkCache> chunk_cache { std::make_unique<Decima::ChunkCache>() };
+        std::unique_ptr<Decima::FileCache> file_cache { std::make_unique<Decima::FileCache>() };
+        std::unique_ptr<ash::thread_pool> workers { std::make_unique<ash::thread_pool>() };
+
+        /** Files that span at least this many chunks are decompressed on the worker pool, zero disables it */
+        std::size_t parallel_unpack_threshold { 4 };
+        /** Number of chunks of a file that are read ahead, decrypted and decompressed at once */
+        std::size_t unpack_window { 32 };
+        /** Maximum amount of compressed data that extract_files keeps in memory at once, in bytes */
+        std::size_t extract_batch_size { 64 * 1024 * 1024 };
+        /** Files that have at least this many objects to parse are parsed on the worker pool, zero disables it */
+        std::size_t parallel_parse_threshold { 256 };
+        /** Number of objects that a worker parses at once into its own arena */
+        std::size_t parse_batch_size { 64 };
         std::unique_ptr<Decima::Prefetch> prefetch;
     };
 }
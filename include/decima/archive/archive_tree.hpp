@@ -1,7 +1,10 @@
 #pragma once
 
+#include <future>
 #include <map>
 #include <set>
+#include <string>
+#include <unordered_map>
 
 #include <imgui.h>
 
@@ -26,7 +29,13 @@ struct SelectionInfo {
     std::uint64_t selected_file { 0 };
     FileInfo highlighted_file;
     std::set<std::uint64_t> selected_files;
-    Decima::CoreFile* file;
+    std::shared_ptr<Decima::CoreFile> file;
+    std::future<std::shared_ptr<Decima::CoreFile>> file_future;
+    /* Reason why the file could not be loaded, shown in place of it */
+    std::string file_error;
+    /* Objects of the file that were shown, by their index; nullptr if an object failed to parse */
+    std::unordered_map<std::size_t, std::shared_ptr<Decima::CoreObject>> objects;
+    std::unordered_map<std::size_t, std::future<std::shared_ptr<Decima::CoreObject>>> object_futures;
 };
 
 template <class T>
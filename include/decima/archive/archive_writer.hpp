@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "decima/archive/archive.hpp"
+#include "util/buffer.hpp"
+#include "util/compressor.hpp"
+#include "util/thread_pool.hpp"
+
+namespace Decima {
+    class ArchiveManager;
+
+    /*
+     * Builds a new archive out of given files. Contents are laid out
+     * one after another and split into chunks of equal size, which are
+     * compressed on the worker pool and written to the file in order.
+     */
+    class ArchiveWriter {
+    public:
+        explicit ArchiveWriter(const Compressor& compressor, CompressionLevel level = CompressionLevel::Normal, ArchiveType type = ArchiveType::Regular);
+
+        /** Adds file with given name. Its contents are kept alive until the archive is written */
+        void add_file(const std::string& name, ash::shared_buffer contents);
+
+        /** Adds file with given hash of its name, e.g. when repacking files whose names are unknown */
+        void add_file(std::uint64_t hash, ash::shared_buffer contents);
+
+        /**
+         * Removes files whose contents are identical to the ones [base] currently resolves, so only
+         * new and changed files are written, e.g. into a patch archive that is layered on top of the
+         * base archives. Returns number of removed files. Must not be called from the worker pool.
+         */
+        std::size_t remove_unchanged(ArchiveManager& base);
+
+        /** Writes all added files to the archive at given path. Throws std::runtime_error on failure */
+        void write(const std::string& path, ash::thread_pool& workers) const;
+
+        /** Maximum size of decompressed data of a single chunk, in bytes */
+        std::uint32_t chunk_maximum_size { 0x40000 };
+
+        /** Number of chunks per worker thread that are compressed before being written */
+        std::size_t chunks_per_worker { 4 };
+
+    private:
+        struct FileInfo {
+            std::uint64_t hash;
+            ash::shared_buffer contents;
+        };
+
+        const Compressor& m_compressor;
+        CompressionLevel m_level;
+        ArchiveType m_type;
+        std::vector<FileInfo> m_files;
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "util/buffer.hpp"
+
+namespace Decima {
+    class ArchiveChunkEntry;
+
+    class ChunkCache {
+    public:
+        using Chunk = ash::shared_buffer;
+
+        /** Default amount of decompressed data kept in the cache, in bytes */
+        static constexpr std::size_t default_budget = 64 * 1024 * 1024;
+
+        explicit ChunkCache(std::size_t budget = default_budget);
+
+        /**
+         * Returns decompressed contents of given chunk if it is present in the cache.
+         * Chunk entries are never reallocated once their archive is opened, so
+         * the address of the entry is used as its key.
+         */
+        [[nodiscard]] Chunk find(const ArchiveChunkEntry& chunk);
+
+        void insert(const ArchiveChunkEntry& chunk, Chunk data);
+        void clear();
+
+        void set_budget(std::size_t budget);
+
+        [[nodiscard]] std::size_t budget() const;
+        [[nodiscard]] std::size_t size() const;
+        [[nodiscard]] std::uint64_t hits() const noexcept { return m_hits; }
+        [[nodiscard]] std::uint64_t misses() const noexcept { return m_misses; }
+
+    private:
+        using Entry = std::pair<const ArchiveChunkEntry*, Chunk>;
+
+        void evict();
+
+        mutable std::mutex m_mutex;
+        std::list<Entry> m_entries;
+        std::unordered_map<const ArchiveChunkEntry*, std::list<Entry>::iterator> m_lookup;
+        std::size_t m_budget;
+        std::size_t m_size { 0 };
+        std::atomic<std::uint64_t> m_hits { 0 };
+        std::atomic<std::uint64_t> m_misses { 0 };
+    };
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Decima {
+    class CoreFile;
+
+    /*
+     * Byte-budgeted LRU cache of files shared by all archives.
+     *
+     * A file is never evicted while someone besides the cache holds
+     * a handle to it (e.g. current selection), or while it is a
+     * dependency of such a file, i.e. its objects are targets of
+     * references from a file that is still in use.
+     *
+     * Cached files count references to files they depend on, so
+     * eviction only has to look at the least recently used files.
+     * Files that depend on each other keep each other cached, so
+     * once nothing else can be evicted, files that are no longer
+     * reachable from files in use are looked for across the cache.
+     *
+     * The cache is split into shards by hash with their own locks and
+     * order of use, so threads that query different files rarely contend.
+     * The budget is shared by all shards, which are evicted in turns.
+     */
+    class FileCache {
+    public:
+        /** Default amount of memory files in the cache may occupy, in bytes */
+        static constexpr std::size_t default_budget = std::size_t(2) * 1024 * 1024 * 1024;
+
+        explicit FileCache(std::size_t budget = default_budget);
+
+        [[nodiscard]] std::shared_ptr<CoreFile> find(std::uint64_t hash);
+
+        /** Inserts file into the cache. If file with the same hash is already present, returns it instead */
+        std::shared_ptr<CoreFile> insert(std::uint64_t hash, std::shared_ptr<CoreFile> file);
+
+        /** Updates memory usage and dependencies of the file, e.g. after it was parsed, if it is still cached */
+        void update(std::uint64_t hash, const CoreFile& file);
+
+        /** Removes file from the cache, e.g. once it was overridden by another archive */
+        void erase(std::uint64_t hash);
+
+        void set_budget(std::size_t budget);
+
+        [[nodiscard]] std::size_t budget() const;
+        [[nodiscard]] std::size_t size() const;
+
+    private:
+        static constexpr std::size_t shard_count = 16;
+
+        struct Entry {
+            std::shared_ptr<CoreFile> file;
+            std::list<std::uint64_t>::iterator position;
+            std::size_t size;
+            /** Hashes of files this file depends on, each counted in dependents of their shards */
+            std::vector<std::uint64_t> dependencies;
+        };
+
+        using EntryIterator = std::unordered_map<std::uint64_t, Entry>::iterator;
+
+        struct Shard {
+            std::mutex mutex;
+            std::unordered_map<std::uint64_t, Entry> entries;
+            std::list<std::uint64_t> order;
+            /** Number of cached files that depend on the file with given hash, whether it is cached or not */
+            std::unordered_map<std::uint64_t, std::size_t> dependents;
+        };
+
+        [[nodiscard]] Shard& shard_of(std::uint64_t hash) noexcept { return m_shards[hash % shard_count]; }
+
+        /* Evicted files are moved out, so they can be destroyed after locks are released */
+        void evict(std::vector<std::shared_ptr<CoreFile>>& evicted);
+        void collect(std::vector<std::shared_ptr<CoreFile>>& evicted);
+
+        /* These must be called with the shard locked; dependencies of removed files are moved out to be released later */
+        void remove(Shard& shard, EntryIterator entry, std::vector<std::shared_ptr<CoreFile>>& evicted, std::vector<std::uint64_t>& released);
+        static void release(Shard& shard, std::uint64_t hash);
+
+        /* These lock shards of dependencies one at a time */
+        void retain(const std::vector<std::uint64_t>& dependencies);
+        void release(const std::vector<std::uint64_t>& dependencies);
+
+        std::array<Shard, shard_count> m_shards;
+        std::atomic<std::size_t> m_budget;
+        std::atomic<std::size_t> m_size { 0 };
+        /** Size the cache must grow to before eviction is attempted again after it failed to get within budget */
+        std::atomic<std::size_t> m_blocked_size { 0 };
+        /** Shard eviction starts from next time, so shards are evicted in turns */
+        std::atomic<std::size_t> m_next_shard { 0 };
+    };
+}
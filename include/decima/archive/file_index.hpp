@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Decima {
+    class ArchiveManager;
+
+    /*
+     * Flat open-addressing table that maps hashes of file names
+     * to their entries across all archives. Name hashes are already
+     * well mixed, so their low bits are used as slot indices directly,
+     * and a lookup usually touches a single cache line.
+     */
+    class FileIndex {
+    public:
+        struct Location {
+            /** Hash of the name of the file */
+            std::uint64_t hash;
+            /** Index of the archive which the file belongs to */
+            std::uint32_t archive;
+            /** Index of the file entry in that archive */
+            std::uint32_t entry;
+        };
+
+        /** Makes room for given total count of files, so no rehashing happens while they are inserted */
+        void reserve(std::size_t count);
+
+        /**
+         * Inserts location of the file, unless there's already a file with the same hash.
+         * Returns location of the file with given hash and whether it was inserted.
+         */
+        std::pair<Location*, bool> insert(std::uint64_t hash, std::uint32_t archive, std::uint32_t entry);
+
+        [[nodiscard]] inline const Location* find(std::uint64_t hash) const noexcept {
+            if (m_slots.empty())
+                return nullptr;
+
+            for (auto index = hash & m_mask;; index = (index + 1) & m_mask) {
+                const auto& slot = m_slots[index];
+
+                if (slot.archive == empty_slot)
+                    return nullptr;
+
+                if (slot.hash == hash)
+                    return &slot;
+            }
+        }
+
+        [[nodiscard]] inline std::size_t size() const noexcept { return m_size; }
+
+    private:
+        friend class ArchiveManager;
+
+        static constexpr std::uint32_t empty_slot = std::numeric_limits<std::uint32_t>::max();
+
+        void rehash(std::size_t capacity);
+
+        std::vector<Location> m_slots;
+        std::size_t m_mask { 0 };
+        std::size_t m_size { 0 };
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "decima/serializable/guid.hpp"
+
+namespace Decima {
+    class CoreFile;
+
+    /*
+     * Maps identifiers of objects to files that define them, across all
+     * files whose object tables were read. Files add their objects once
+     * they read their tables and remove them once they are destroyed, e.g.
+     * evicted from the cache, so only files that are in memory are known.
+     *
+     * The index is split into shards with their own locks, so threads that
+     * parse different files rarely contend. Each shard is a flat open-addressing
+     * table keyed by full identifiers; identifiers are random already, so their
+     * hashes are used as slot indices directly.
+     */
+    class ObjectIndex {
+    public:
+        struct Location {
+            /** Hash of the name of the file which defines the object */
+            std::uint64_t file;
+            /** Index of the object in the table of objects of that file */
+            std::uint32_t object;
+        };
+
+        /** Adds object defined by given file, replacing any previous definition with the same identifier */
+        void insert(const GUID& guid, const CoreFile* owner, Location location);
+
+        /** Removes object, unless it has been defined by another file since then */
+        void erase(const GUID& guid, const CoreFile* owner);
+
+        [[nodiscard]] std::optional<Location> find(const GUID& guid) const;
+
+        [[nodiscard]] std::size_t size() const;
+
+    private:
+        static constexpr std::size_t shard_count = 64;
+
+        struct Slot {
+            GUID guid;
+            /** File which defined the object, or nullptr if the slot is empty */
+            const CoreFile* owner;
+            Location location;
+        };
+
+        struct Shard {
+            mutable std::mutex mutex;
+            std::vector<Slot> slots;
+            std::size_t mask { 0 };
+            std::size_t size { 0 };
+        };
+
+        static inline std::size_t shard_of(const GUID& guid) noexcept { return guid.hash() % shard_count; }
+        static inline std::size_t slot_of(const GUID& guid) noexcept { return guid.hash() / shard_count; }
+
+        static void rehash(Shard& shard, std::size_t capacity);
+
+        std::array<Shard, shard_count> m_shards;
+    };
+}
@@ -1,14 +1,20 @@
 #pragma once
 
+#include <memory_resource>
 #include <type_traits>
 #include <vector>
 
 #include "decima/serializable/object/object.hpp"
 #include "decima/serializable/serializable.hpp"
+#include "util/arena.hpp"
 
 namespace Decima {
     class ArchiveManager;
 
+    /*
+     * Items of arrays that are constructed while a file is parsed are
+     * allocated from the arena of that file, see CoreFile::parse.
+     */
     template <typename T, typename = void>
     class Array : public CoreSerializable {
     public:
@@ -20,11 +26,11 @@ namespace Decima {
             buffer.get(m_data);
         }
 
-        inline const std::vector<T>& data() const { return m_data; }
-        inline std::vector<T>& data() { return m_data; }
+        inline const std::pmr::vector<T>& data() const { return m_data; }
+        inline std::pmr::vector<T>& data() { return m_data; }
 
     private:
-        std::vector<T> m_data;
+        std::pmr::vector<T> m_data { ash::current_resource() };
     };
 
     template <typename T>
@@ -37,11 +43,11 @@ namespace Decima {
                 item.parse(buffer, file);
         }
 
-        inline const std::vector<T>& data() const { return m_data; }
-        inline std::vector<T>& data() { return m_data; }
+        inline const std::pmr::vector<T>& data() const { return m_data; }
+        inline std::pmr::vector<T>& data() { return m_data; }
 
     private:
-        std::vector<T> m_data;
+        std::pmr::vector<T> m_data { ash::current_resource() };
     };
 
     template <typename T>
@@ -54,10 +60,10 @@ namespace Decima {
                 item.parse(manager, buffer);
         }
 
-        inline const std::vector<T>& data() const { return m_data; }
-        inline std::vector<T>& data() { return m_data; }
+        inline const std::pmr::vector<T>& data() const { return m_data; }
+        inline std::pmr::vector<T>& data() { return m_data; }
 
     private:
-        std::vector<T> m_data;
+        std::pmr::vector<T> m_data { ash::current_resource() };
     };
 }
\ No newline at end of file
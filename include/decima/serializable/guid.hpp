@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstring>
 #include <functional>
 
 #include "decima/shared.hpp"
@@ -21,6 +22,15 @@ namespace Decima {
             return hash(m_data_8[0]) ^ hash(m_data_8[1]);
         }
 
+        /* Different identifiers may share a hash, so all 16 bytes are compared */
+        inline bool operator==(const GUID& other) const noexcept {
+            return std::memcmp(m_data_1.data(), other.m_data_1.data(), sizeof(m_data_1)) == 0;
+        }
+
+        inline bool operator!=(const GUID& other) const noexcept {
+            return !(*this == other);
+        }
+
     private:
         friend std::string Decima::to_string(const Decima::GUID& value);
 
@@ -33,6 +43,15 @@ namespace Decima {
     static_assert(sizeof(GUID) == 16);
 }
 
+namespace std {
+    template <>
+    struct hash<Decima::GUID> {
+        inline std::size_t operator()(const Decima::GUID& value) const noexcept {
+            return value.hash();
+        }
+    };
+}
+
 template <>
 inline std::string Decima::to_string(const Decima::GUID& value) {
     std::string buffer(36, ' ');
@@ -23,6 +23,9 @@ namespace Decima {
         virtual void parse(ArchiveManager& manager, ash::buffer& buffer, CoreFile& file);
         virtual void draw();
 
+        /** Starts unpacking data the object keeps outside of its file, e.g. in stream files, so it's ready once the object is drawn */
+        virtual void request_external_data();
+
         inline static CoreHeader peek_header(ash::buffer buffer) {
             return buffer.get<CoreHeader>();
         }
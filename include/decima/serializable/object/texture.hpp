@@ -9,6 +9,10 @@
 
 #include <glad/glad.h>
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace Decima {
     enum class TexturePixelFormat : std::uint8_t {
         RGBA8 = 0xC,
@@ -48,16 +52,42 @@ namespace Decima {
 
     extern const std::unordered_map<TexturePixelFormat, TexturePixelFormatInfo> texture_format_info;
 
+    /*
+     * Textures may be destroyed on any thread (e.g. when their file is evicted
+     * from a worker), but OpenGL objects can only be deleted on the render thread.
+     * Destroyed textures hand their objects over to this queue, and the render
+     * loop deletes them every frame. Textures share ownership of the queue they
+     * were created with, so it's safe to destroy them after the app is gone.
+     */
+    class TextureReleaseQueue {
+    public:
+        void push(const std::vector<unsigned int>& textures);
+
+        /** Deletes all textures pushed so far, must be called on the render thread */
+        void release();
+
+    private:
+        std::mutex m_mutex;
+        std::vector<unsigned int> m_textures;
+    };
+
     class Texture : public CoreObject {
     public:
         ~Texture();
 
+        /** Sets queue that textures created from now on release their objects to, must be called on the render thread */
+        static void set_release_queue(std::shared_ptr<TextureReleaseQueue> queue);
+
         void parse(ArchiveManager& manager, ash::buffer& buffer, CoreFile& file) override;
         void draw() override;
+        void request_external_data() override;
 
     private:
         void draw_preview(float preview_width, float preview_height, float zoom_region, float zoom_scale);
 
+        /** Uploads mips to the GPU once external data is unpacked, must be called on the render thread */
+        void create_textures();
+
         TextureType type;
         std::uint16_t width;
         std::uint16_t height;
@@ -76,6 +106,8 @@ namespace Decima {
         Decima::Stream external_data;
         std::vector<char> embedded_data;
         std::vector<unsigned int> mip_textures;
+        std::shared_ptr<TextureReleaseQueue> release_queue;
+        bool textures_created { false };
         int mip_index;
     };
 }
@@ -1,9 +1,17 @@
 #pragma once
 
+#include <future>
+#include <mutex>
+
 #include "decima/archive/archive_manager.hpp"
 #include "decima/serializable/string.hpp"
 
 namespace Decima {
+    /*
+     * Range of a .core.stream file that holds bulk data of an object,
+     * e.g. mips of a texture. Only the range is recorded when parsed,
+     * and it's unpacked on first access to the data.
+     */
     class Stream {
     public:
         void parse(ArchiveManager& manager, ash::buffer& buffer, CoreFile& file);
@@ -12,12 +20,21 @@ namespace Decima {
         inline const String& name() const noexcept { return m_name; }
         inline std::uint32_t offset() const noexcept { return m_offs; }
         inline std::uint32_t size() const noexcept { return m_size; }
-        inline const std::vector<char>& data() const noexcept { return m_data; }
+        /**
+         * Contents of the range of the stream file this stream refers to, unpacked once on first call.
+         * Blocks until the range is unpacked, and throws if it can't be, see ArchiveManager::read_range.
+         */
+        const ash::shared_buffer& data() const;
+
+        /** Starts unpacking the range on the worker pool, unless it's unpacked or being unpacked already, see data() */
+        std::shared_future<ash::shared_buffer> data_async() const;
 
     private:
+        ArchiveManager* m_manager { nullptr };
         String m_name;
         std::uint32_t m_offs;
         std::uint32_t m_size;
-        std::vector<char> m_data;
+        mutable std::once_flag m_data_requested;
+        mutable std::shared_future<ash::shared_buffer> m_data;
     };
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <utility>
 
 #include "decima/shared.hpp"
 #include "decima/archive/archive_file.hpp"
@@ -24,6 +26,12 @@ namespace Decima {
 
     class StringHashed : public CoreSerializable {
     public:
+        StringHashed() = default;
+
+        inline StringHashed(std::string data, std::uint32_t hash)
+            : m_hash(hash)
+            , m_data(std::move(data)) { }
+
         void parse(ash::buffer& buffer, CoreFile& file);
         void draw();
         void draw(StringMutator mutator);
@@ -32,7 +40,7 @@ namespace Decima {
         inline const std::string& data() const noexcept { return m_data; }
 
     private:
-        std::uint32_t m_hash;
+        std::uint32_t m_hash { 0 };
         std::string m_data;
     };
 }
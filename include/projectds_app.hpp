@@ -2,11 +2,14 @@
 
 #include "app.hpp"
 
+#include <future>
+
 #include <imgui.h>
 #include <imgui_memory_editor.h>
 
 #include "decima/archive/archive_manager.hpp"
 #include "decima/archive/archive_tree.hpp"
+#include "decima/serializable/object/texture.hpp"
 
 class ProjectDS : public App {
 public:
@@ -40,7 +43,8 @@ public:
     SelectionInfo selection_info;
     ImGuiTextFilter filter;
     MemoryEditor file_viewer;
-    bool root_tree_constructing { false };
+    std::future<FileTree> root_tree_future;
+    std::shared_ptr<Decima::TextureReleaseQueue> texture_release_queue { std::make_shared<Decima::TextureReleaseQueue>() };
 
     void init_user() override;
 
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace ash {
+    /*
+     * Monotonic memory resource that releases everything allocated
+     * from it at once when it's destroyed; single deallocations are
+     * no-ops. Only one thread may allocate from it at a time.
+     */
+    class arena final : public std::pmr::memory_resource {
+    public:
+        explicit inline arena(std::size_t initial_size)
+            : m_resource(initial_size) { }
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        /** Total amount of memory allocated from this arena, in bytes */
+        inline std::size_t size() const noexcept { return m_size.load(std::memory_order_relaxed); }
+
+        /** Arena that is current on this thread, or null if there's none */
+        inline static const std::shared_ptr<arena>& current() noexcept { return s_current; }
+
+    private:
+        friend class arena_scope;
+
+        inline void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            m_size.fetch_add(bytes, std::memory_order_relaxed);
+            return m_resource.allocate(bytes, alignment);
+        }
+
+        inline void do_deallocate(void*, std::size_t, std::size_t) override { }
+
+        inline bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        inline static thread_local std::shared_ptr<arena> s_current;
+
+        std::pmr::monotonic_buffer_resource m_resource;
+        std::atomic<std::size_t> m_size { 0 };
+    };
+
+    /* Makes given arena current on this thread for the lifetime of the scope */
+    class arena_scope {
+    public:
+        explicit inline arena_scope(std::shared_ptr<arena> arena)
+            : m_previous(std::exchange(arena::s_current, std::move(arena))) { }
+
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+
+        inline ~arena_scope() {
+            arena::s_current = std::move(m_previous);
+        }
+
+    private:
+        std::shared_ptr<arena> m_previous;
+    };
+
+    /** Returns the current arena of this thread, or the default memory resource if there's none */
+    inline std::pmr::memory_resource* current_resource() noexcept {
+        if (const auto& current = arena::current())
+            return current.get();
+        return std::pmr::get_default_resource();
+    }
+
+    /*
+     * Allocator that shares ownership of its arena, so objects created with
+     * std::allocate_shared keep the arena alive for as long as they exist.
+     */
+    template <typename T>
+    class arena_allocator {
+    public:
+        using value_type = T;
+
+        explicit inline arena_allocator(std::shared_ptr<arena> arena) noexcept
+            : m_arena(std::move(arena)) { }
+
+        template <typename U>
+        inline arena_allocator(const arena_allocator<U>& other) noexcept
+            : m_arena(other.m_arena) { }
+
+        inline T* allocate(std::size_t count) {
+            return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        inline void deallocate(T* data, std::size_t count) noexcept {
+            m_arena->deallocate(data, count * sizeof(T), alignof(T));
+        }
+
+        template <typename U>
+        inline bool operator==(const arena_allocator<U>& other) const noexcept { return m_arena == other.m_arena; }
+
+        template <typename U>
+        inline bool operator!=(const arena_allocator<U>& other) const noexcept { return m_arena != other.m_arena; }
+
+    private:
+        template <typename U>
+        friend class arena_allocator;
+
+        std::shared_ptr<arena> m_arena;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <stdexcept>
 #include <string>
 
@@ -91,4 +92,52 @@ namespace ash {
     };
 
     typedef basic_buffer<char> buffer;
+
+    /*
+     * Read-only view into a block of memory that is kept alive
+     * for as long as any view into it exists. Slicing shares
+     * ownership instead of copying.
+     */
+    class shared_buffer {
+    public:
+        inline shared_buffer() noexcept = default;
+
+        inline shared_buffer(std::shared_ptr<const char> owner, std::size_t size) noexcept
+            : m_owner(std::move(owner))
+            , m_size(size)
+            , m_capacity(size) { }
+
+        /** Allocates uninitialized block of memory of given size */
+        inline static std::pair<shared_buffer, char*> allocate(std::size_t size) {
+            auto data = new char[size];
+            return { shared_buffer(std::shared_ptr<const char>(data, std::default_delete<char[]>()), size), data };
+        }
+
+        inline const char* data() const noexcept { return m_owner.get(); }
+
+        inline const char* begin() const noexcept { return data(); }
+        inline const char* end() const noexcept { return data() + m_size; }
+
+        inline std::size_t size() const noexcept { return m_size; }
+        inline bool empty() const noexcept { return m_size == 0; }
+
+        /** Size of the whole block of memory this view keeps alive, which is larger than the view itself for slices */
+        inline std::size_t capacity() const noexcept { return m_capacity; }
+
+        inline explicit operator bool() const noexcept { return m_owner != nullptr; }
+        inline operator buffer() const noexcept { return { data(), m_size }; }
+
+        inline shared_buffer slice(std::size_t offset, std::size_t count) const {
+            if (offset + count > m_size)
+                throw std::range_error("Cannot take slice that is larger than buffer");
+            shared_buffer result(std::shared_ptr<const char>(m_owner, data() + offset), count);
+            result.m_capacity = m_capacity;
+            return result;
+        }
+
+    private:
+        std::shared_ptr<const char> m_owner;
+        std::size_t m_size { 0 };
+        std::size_t m_capacity { 0 };
+    };
 }
@@ -1,8 +1,15 @@
 #pragma once
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <dlfcn.h>
+#endif
 
+#include <array>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 
 namespace Decima {
@@ -19,40 +26,98 @@ namespace Decima {
         Optimal5
     };
 
+    /*
+     * Codec used to compress and decompress chunks of archives.
+     * All methods must be safe to call from multiple threads at once.
+     */
     class Compressor {
+    public:
+        virtual ~Compressor() = default;
+
+        /** Compresses [src_len] bytes into [dst], which must be at least compression_bound(src_len) bytes. Returns size of compressed data, throws std::runtime_error on failure */
+        virtual std::uint32_t compress(const void* src, std::size_t src_len, void* dst, CompressionLevel level) const = 0;
+
+        /** Decompresses data into [dst] that must be exactly [dst_len] bytes. Returns size of decompressed data, or zero on failure */
+        virtual std::uint32_t decompress(const void* src, std::size_t src_len, void* dst, std::size_t dst_len) const = 0;
+
+        /** Returns maximum size of compressed data for the input of given size */
+        virtual std::size_t compression_bound(std::size_t size) const noexcept = 0;
+
+        template <typename Input, typename Output>
+        inline std::uint32_t compress(const Input& input, Output& output, CompressionLevel level = CompressionLevel::Normal) const {
+            output.resize(compression_bound(input.size()));
+            const auto size = compress(input.data(), input.size(), output.data(), level);
+            output.resize(size);
+            return size;
+        }
+
+        template <typename Input, typename Output>
+        inline std::uint32_t decompress(const Input& input, Output& output) const {
+            return decompress(input.data(), input.size(), output.data(), output.size());
+        }
+    };
+
+    /* Oodle library shipped with the game, loaded at runtime */
+    class OodleCompressor final : public Compressor {
     public:
         typedef int (*CompressFn)(int format, const std::uint8_t* src, std::size_t src_len, std::uint8_t* dst, int level, void*, std::size_t, std::size_t, void*, std::size_t);
         typedef int (*DecompressFn)(const std::uint8_t* src, std::size_t src_len, std::uint8_t* dst, std::size_t dst_len, int fuzz, int crc, int verbose, std::uint8_t*, std::size_t, void*, void*, void*, std::size_t, int);
         typedef std::uint64_t (*GetConfigValuesFn)(std::uint8_t* buffer);
 
+#ifdef _WIN32
+        using native_handle_type = HMODULE;
+#else
+        using native_handle_type = void*;
+#endif
+
     public:
-        explicit inline Compressor(HMODULE module)
-            : m_module(module)
-            , m_compress(reinterpret_cast<CompressFn>(GetProcAddress(m_module, "OodleLZ_Compress")))
-            , m_decompress(reinterpret_cast<DecompressFn>(GetProcAddress(m_module, "OodleLZ_Decompress")))
-            , m_get_config_values(reinterpret_cast<GetConfigValuesFn>(GetProcAddress(m_module, "Oodle_GetConfigValues"))) { }
+        explicit inline OodleCompressor(const std::string& path)
+#ifdef _WIN32
+            : m_module(LoadLibraryA(path.c_str()))
+#else
+            : m_module(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL))
+#endif
+        {
+            if (m_module == nullptr)
+                throw std::runtime_error("Cannot load compressor library '" + path + "'");
+
+            m_compress = reinterpret_cast<CompressFn>(find_symbol("OodleLZ_Compress"));
+            m_decompress = reinterpret_cast<DecompressFn>(find_symbol("OodleLZ_Decompress"));
+            m_get_config_values = reinterpret_cast<GetConfigValuesFn>(find_symbol("Oodle_GetConfigValues"));
 
-        explicit inline Compressor(const std::string& path)
-            : Compressor(LoadLibraryA(path.c_str())) { }
+            if (m_compress == nullptr || m_decompress == nullptr || m_get_config_values == nullptr) {
+                unload();
+                throw std::runtime_error("Library '" + path + "' is not a compressor library");
+            }
+        }
 
-        explicit inline Compressor(const std::wstring& path)
-            : Compressor(LoadLibraryW(path.c_str())) { }
+        OodleCompressor(const OodleCompressor&) = delete;
+        OodleCompressor& operator=(const OodleCompressor&) = delete;
 
-        inline ~Compressor() {
-            FreeLibrary(m_module);
+        inline ~OodleCompressor() override {
+            unload();
         }
 
-        template <typename Input, typename Output>
-        inline std::uint32_t compress(const Input& input, Output& output, CompressionLevel level = CompressionLevel::Normal) const noexcept {
-            output.resize(calculate_compression_bound(input.size()));
-            return m_compress(8, (std::uint8_t*)input.data(), input.size(), (std::uint8_t*)output.data(), static_cast<int>(level), nullptr, 0, 0, nullptr, 0);
+        inline std::uint32_t compress(const void* src, std::size_t src_len, void* dst, CompressionLevel level) const override {
+            const auto size = m_compress(8, (const std::uint8_t*)src, src_len, (std::uint8_t*)dst, static_cast<int>(level), nullptr, 0, 0, nullptr, 0);
+
+            if (size <= 0)
+                throw std::runtime_error("Cannot compress block of " + std::to_string(src_len) + " bytes");
+
+            return static_cast<std::uint32_t>(size);
         }
 
-        template <typename Input, typename Output>
-        inline std::uint32_t decompress(const Input& input, Output& output, int crc = 0) const noexcept {
-            return m_decompress((std::uint8_t*)input.data(), input.size(), (std::uint8_t*)output.data(), output.size(), 0, crc, 0, nullptr, 0, nullptr, nullptr, nullptr, 0, 0);
+        inline std::uint32_t decompress(const void* src, std::size_t src_len, void* dst, std::size_t dst_len) const override {
+            return m_decompress((const std::uint8_t*)src, src_len, (std::uint8_t*)dst, dst_len, 0, 0, 0, nullptr, 0, nullptr, nullptr, nullptr, 0, 0);
+        }
+
+        inline std::size_t compression_bound(std::size_t size) const noexcept override {
+            return size + 274 * ((size + 0x3FFFF) / 0x40000);
         }
 
+        using Compressor::compress;
+        using Compressor::decompress;
+
         inline std::uint64_t get_version() const noexcept {
             std::array<std::uint32_t, 7> buffer {};
             m_get_config_values((std::uint8_t*)buffer.data());
@@ -65,13 +130,25 @@ namespace Decima {
         }
 
     private:
-        inline static std::size_t calculate_compression_bound(std::size_t size) noexcept {
-            return size + 274 * ((size + 0x3FFFF) / 0x40000);
+        inline void* find_symbol(const char* name) const noexcept {
+#ifdef _WIN32
+            return reinterpret_cast<void*>(GetProcAddress(m_module, name));
+#else
+            return dlsym(m_module, name);
+#endif
+        }
+
+        inline void unload() noexcept {
+#ifdef _WIN32
+            FreeLibrary(m_module);
+#else
+            dlclose(m_module);
+#endif
         }
 
-        HMODULE m_module;
-        CompressFn m_compress;
-        DecompressFn m_decompress;
-        GetConfigValuesFn m_get_config_values;
+        native_handle_type m_module;
+        CompressFn m_compress { nullptr };
+        DecompressFn m_decompress { nullptr };
+        GetConfigValuesFn m_get_config_values { nullptr };
     };
 }
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "util/buffer.hpp"
+
+namespace ash {
+    /*
+     * Read-only view of the whole file mapped into memory.
+     * Reads are positional, so a single mapping can be safely
+     * shared between any number of readers without seeking.
+     */
+    class mapped_file {
+    public:
+#ifdef _WIN32
+        using native_handle_type = HANDLE;
+#else
+        using native_handle_type = int;
+#endif
+
+        explicit inline mapped_file(const std::string& path) {
+#ifdef _WIN32
+            m_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+            if (m_handle == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("Cannot open file '" + path + "'");
+
+            LARGE_INTEGER size;
+
+            if (!GetFileSizeEx(m_handle, &size)) {
+                close();
+                throw std::runtime_error("Cannot get size of file '" + path + "'");
+            }
+
+            m_size = static_cast<std::size_t>(size.QuadPart);
+
+            if (m_size > 0) {
+                m_mapping = CreateFileMappingA(m_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+                if (m_mapping == nullptr) {
+                    close();
+                    throw std::runtime_error("Cannot map file '" + path + "'");
+                }
+
+                m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+#else
+            m_handle = ::open(path.c_str(), O_RDONLY);
+
+            if (m_handle < 0)
+                throw std::runtime_error("Cannot open file '" + path + "'");
+
+            struct stat info {};
+
+            if (::fstat(m_handle, &info) != 0) {
+                close();
+                throw std::runtime_error("Cannot get size of file '" + path + "'");
+            }
+
+            m_size = static_cast<std::size_t>(info.st_size);
+
+            if (m_size > 0) {
+                void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_handle, 0);
+                m_data = data != MAP_FAILED ? static_cast<const char*>(data) : nullptr;
+            }
+#endif
+
+            if (m_size > 0 && m_data == nullptr) {
+                close();
+                throw std::runtime_error("Cannot map file '" + path + "'");
+            }
+        }
+
+        inline mapped_file(mapped_file&& other) noexcept
+            : m_handle(std::exchange(other.m_handle, invalid_handle()))
+#ifdef _WIN32
+            , m_mapping(std::exchange(other.m_mapping, nullptr))
+#endif
+            , m_data(std::exchange(other.m_data, nullptr))
+            , m_size(std::exchange(other.m_size, 0)) {
+        }
+
+        inline mapped_file& operator=(mapped_file&& other) noexcept {
+            if (this != &other) {
+                close();
+                m_handle = std::exchange(other.m_handle, invalid_handle());
+#ifdef _WIN32
+                m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+                m_data = std::exchange(other.m_data, nullptr);
+                m_size = std::exchange(other.m_size, 0);
+            }
+
+            return *this;
+        }
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        inline ~mapped_file() {
+            close();
+        }
+
+        inline const char* data() const noexcept { return m_data; }
+        inline std::size_t size() const noexcept { return m_size; }
+        inline native_handle_type native_handle() const noexcept { return m_handle; }
+
+        /** Asks the system to start reading given range of the file in background, so later accesses don't block */
+        inline void prefetch(std::size_t offset, std::size_t count) const noexcept {
+            if (offset >= m_size || count == 0)
+                return;
+
+            count = std::min(count, m_size - offset);
+
+#ifdef _WIN32
+            WIN32_MEMORY_RANGE_ENTRY range { const_cast<char*>(m_data + offset), count };
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+            const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+            const auto page_offset = offset / page_size * page_size;
+            ::madvise(const_cast<char*>(m_data) + page_offset, offset + count - page_offset, MADV_WILLNEED);
+#endif
+        }
+
+        inline buffer view() const noexcept {
+            return { m_data, m_size };
+        }
+
+        inline buffer view(std::size_t offset, std::size_t count) const {
+            return view().slice(offset, count);
+        }
+
+    private:
+        inline static native_handle_type invalid_handle() noexcept {
+#ifdef _WIN32
+            return INVALID_HANDLE_VALUE;
+#else
+            return -1;
+#endif
+        }
+
+        inline void close() noexcept {
+#ifdef _WIN32
+            if (m_data != nullptr)
+                UnmapViewOfFile(m_data);
+            if (m_mapping != nullptr)
+                CloseHandle(m_mapping);
+            if (m_handle != INVALID_HANDLE_VALUE)
+                CloseHandle(m_handle);
+            m_mapping = nullptr;
+#else
+            if (m_data != nullptr)
+                ::munmap(const_cast<char*>(m_data), m_size);
+            if (m_handle >= 0)
+                ::close(m_handle);
+#endif
+            m_handle = invalid_handle();
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        native_handle_type m_handle { invalid_handle() };
+#ifdef _WIN32
+        HANDLE m_mapping { nullptr };
+#endif
+        const char* m_data { nullptr };
+        std::size_t m_size { 0 };
+    };
+}
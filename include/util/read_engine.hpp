@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <cerrno>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <linux/io_uring.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+namespace ash {
+    /** Single positional read of [size] bytes at [offset] of [file] into [buffer] */
+    struct read_request {
+#ifdef _WIN32
+        HANDLE file;
+#else
+        int file;
+#endif
+        std::uint64_t offset;
+        std::size_t size;
+        char* buffer;
+    };
+
+    /*
+     * Reads batches of independent requests keeping many of them in flight
+     * at once. Uses io_uring where the kernel provides it, and falls back to
+     * reading requests one by one with preadv (or ReadFile on Windows).
+     * A single engine must not be used from several threads at once.
+     */
+    class read_engine {
+    public:
+        explicit inline read_engine(unsigned queue_depth = 128) {
+#ifdef __linux__
+            io_uring_params params {};
+            m_ring = static_cast<int>(::syscall(__NR_io_uring_setup, queue_depth, &params));
+
+            if (m_ring < 0)
+                return;
+
+            m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+                m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+
+            m_sq_ring = map_ring(m_sq_size, IORING_OFF_SQ_RING);
+            m_cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? m_sq_ring : map_ring(m_cq_size, IORING_OFF_CQ_RING);
+            m_sqes = static_cast<io_uring_sqe*>(map_ring(params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+
+            if (m_sq_ring == nullptr || m_cq_ring == nullptr || m_sqes == nullptr) {
+                close_ring();
+                return;
+            }
+
+            m_sq_entries = params.sq_entries;
+            m_sq_head = ring_field(m_sq_ring, params.sq_off.head);
+            m_sq_tail = ring_field(m_sq_ring, params.sq_off.tail);
+            m_sq_mask = *ring_field(m_sq_ring, params.sq_off.ring_mask);
+            m_sq_array = ring_field(m_sq_ring, params.sq_off.array);
+            m_cq_head = ring_field(m_cq_ring, params.cq_off.head);
+            m_cq_tail = ring_field(m_cq_ring, params.cq_off.tail);
+            m_cq_mask = *ring_field(m_cq_ring, params.cq_off.ring_mask);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(m_cq_ring) + params.cq_off.cqes);
+#else
+            (void)queue_depth;
+#endif
+        }
+
+        read_engine(const read_engine&) = delete;
+        read_engine& operator=(const read_engine&) = delete;
+
+        inline ~read_engine() {
+#ifdef __linux__
+            close_ring();
+#endif
+        }
+
+        /** Returns true if requests are submitted to the kernel in batches rather than read one by one */
+        inline bool batched() const noexcept {
+#ifdef __linux__
+            return m_ring >= 0;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * Reads all requests, calling [on_complete] with index of every request once it
+         * is read completely. Requests complete in any order. Throws std::runtime_error
+         * if any of the requests fails.
+         */
+        template <typename Function>
+        inline void read(const std::vector<read_request>& requests, Function&& on_complete) {
+#ifdef __linux__
+            if (batched()) {
+                read_batched(requests, on_complete);
+                return;
+            }
+#endif
+
+            for (std::size_t index = 0; index < requests.size(); index++) {
+                read_remaining(requests[index], 0);
+                on_complete(index);
+            }
+        }
+
+    private:
+        /* Reads the rest of the request starting at given number of bytes already read */
+        inline static void read_remaining(const read_request& request, std::size_t done) {
+            while (done < request.size) {
+#ifdef _WIN32
+                OVERLAPPED overlapped {};
+                overlapped.Offset = static_cast<DWORD>((request.offset + done) & 0xffffffff);
+                overlapped.OffsetHigh = static_cast<DWORD>((request.offset + done) >> 32);
+
+                DWORD count = 0;
+                const auto chunk = static_cast<DWORD>(std::min<std::size_t>(request.size - done, 0x40000000));
+
+                if (!ReadFile(request.file, request.buffer + done, chunk, &count, &overlapped) || count == 0)
+                    throw std::runtime_error("Cannot read " + std::to_string(request.size) + " bytes at offset " + std::to_string(request.offset));
+#else
+                iovec vector { request.buffer + done, request.size - done };
+                const auto count = ::preadv(request.file, &vector, 1, static_cast<off_t>(request.offset + done));
+
+                if (count < 0 && errno == EINTR)
+                    continue;
+
+                if (count <= 0)
+                    throw std::runtime_error("Cannot read " + std::to_string(request.size) + " bytes at offset " + std::to_string(request.offset));
+#endif
+
+                done += static_cast<std::size_t>(count);
+            }
+        }
+
+#ifdef __linux__
+        template <typename Function>
+        inline void read_batched(const std::vector<read_request>& requests, Function& on_complete) {
+            std::vector<iovec> vectors(requests.size());
+            std::size_t submitted = 0;
+            std::size_t in_flight = 0;
+
+            /* Requests that are already in the ring, but not yet taken by the kernel */
+            unsigned unsubmitted = 0;
+
+            /*
+             * Requests that are already submitted must be waited for even if
+             * something fails, since the kernel keeps writing into their buffers.
+             */
+            std::exception_ptr error;
+
+            while (in_flight > 0 || (error == nullptr && submitted < requests.size())) {
+                auto sq_tail = *m_sq_tail;
+
+                while (error == nullptr && submitted < requests.size() && in_flight < m_sq_entries && sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) < m_sq_entries) {
+                    const auto& request = requests[submitted];
+                    const auto slot = sq_tail & m_sq_mask;
+
+                    vectors[submitted] = { request.buffer, request.size };
+
+                    auto& sqe = m_sqes[slot];
+                    std::memset(&sqe, 0, sizeof(sqe));
+                    sqe.opcode = IORING_OP_READV;
+                    sqe.fd = request.file;
+                    sqe.off = request.offset;
+                    sqe.addr = reinterpret_cast<std::uint64_t>(&vectors[submitted]);
+                    sqe.len = 1;
+                    sqe.user_data = submitted;
+
+                    m_sq_array[slot] = slot;
+                    sq_tail++;
+                    submitted++;
+                    in_flight++;
+                    unsubmitted++;
+                }
+
+                __atomic_store_n(m_sq_tail, sq_tail, __ATOMIC_RELEASE);
+
+                /*
+                 * The kernel may take only some of the requests, e.g. when interrupted,
+                 * so the rest is submitted again on the next round. If it fails for good,
+                 * requests it didn't take are withdrawn from the ring, and the ones it did
+                 * are still reaped below; their completions are posted to the ring without
+                 * entering the kernel, so it's polled until all of them arrive.
+                 */
+                if (const auto entered = ::syscall(__NR_io_uring_enter, m_ring, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0); entered >= 0) {
+                    unsubmitted -= static_cast<unsigned>(entered);
+                } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    if (error == nullptr)
+                        error = std::make_exception_ptr(std::runtime_error("Cannot submit read requests: " + std::string(std::strerror(errno))));
+
+                    __atomic_store_n(m_sq_tail, sq_tail - unsubmitted, __ATOMIC_RELEASE);
+                    in_flight -= unsubmitted;
+                    unsubmitted = 0;
+
+                    ::sched_yield();
+                }
+
+                auto cq_head = *m_cq_head;
+
+                for (; cq_head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE); cq_head++) {
+                    const auto& cqe = m_cqes[cq_head & m_cq_mask];
+                    const auto index = static_cast<std::size_t>(cqe.user_data);
+                    const auto result = cqe.res;
+
+                    __atomic_store_n(m_cq_head, cq_head + 1, __ATOMIC_RELEASE);
+                    in_flight--;
+
+                    if (error != nullptr)
+                        continue;
+
+                    try {
+                        if (result < 0)
+                            throw std::runtime_error("Cannot read " + std::to_string(requests[index].size) + " bytes at offset " + std::to_string(requests[index].offset) + ": " + std::strerror(-result));
+
+                        /* Short reads are rare, so the rest is simply read synchronously */
+                        read_remaining(requests[index], static_cast<std::size_t>(result));
+                        on_complete(index);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            if (error != nullptr)
+                std::rethrow_exception(error);
+        }
+
+        inline void* map_ring(std::size_t size, std::uint64_t offset) const noexcept {
+            void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, static_cast<off_t>(offset));
+            return data != MAP_FAILED ? data : nullptr;
+        }
+
+        inline static unsigned* ring_field(void* ring, std::uint32_t offset) noexcept {
+            return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+        }
+
+        inline void close_ring() noexcept {
+            if (m_sqes != nullptr)
+                ::munmap(m_sqes, m_sq_entries * sizeof(io_uring_sqe));
+            if (m_cq_ring != nullptr && m_cq_ring != m_sq_ring)
+                ::munmap(m_cq_ring, m_cq_size);
+            if (m_sq_ring != nullptr)
+                ::munmap(m_sq_ring, m_sq_size);
+            if (m_ring >= 0)
+                ::close(m_ring);
+
+            m_ring = -1;
+            m_sq_ring = m_cq_ring = nullptr;
+            m_sqes = nullptr;
+        }
+
+        int m_ring { -1 };
+        std::size_t m_sq_size { 0 };
+        std::size_t m_cq_size { 0 };
+        void* m_sq_ring { nullptr };
+        void* m_cq_ring { nullptr };
+        io_uring_sqe* m_sqes { nullptr };
+        io_uring_cqe* m_cqes { nullptr };
+        unsigned m_sq_entries { 0 };
+        unsigned* m_sq_head { nullptr };
+        unsigned* m_sq_tail { nullptr };
+        unsigned m_sq_mask { 0 };
+        unsigned* m_sq_array { nullptr };
+        unsigned* m_cq_head { nullptr };
+        unsigned* m_cq_tail { nullptr };
+        unsigned m_cq_mask { 0 };
+#endif
+    };
+}
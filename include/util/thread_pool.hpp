@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ash {
+    class thread_pool {
+    public:
+        explicit inline thread_pool(std::size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+            m_threads.reserve(threads);
+
+            for (std::size_t index = 0; index < threads; index++) {
+                m_threads.emplace_back([this] { worker(); });
+            }
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        inline ~thread_pool() {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = true;
+            }
+
+            m_condition.notify_all();
+
+            for (auto& thread : m_threads) {
+                thread.join();
+            }
+        }
+
+        inline std::size_t size() const noexcept { return m_threads.size(); }
+
+        template <typename Function>
+        inline auto submit(Function&& function) -> std::future<std::invoke_result_t<Function>> {
+            using Result = std::invoke_result_t<Function>;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+            auto result = task->get_future();
+
+            {
+                std::lock_guard lock(m_mutex);
+                m_tasks.emplace_back([task] { (*task)(); });
+            }
+
+            m_condition.notify_one();
+
+            return result;
+        }
+
+        /*
+         * Invokes function for every index in [begin, end) and waits until all of them are done.
+         * The calling thread takes part in the work, so it is safe to call this from a task
+         * that is itself running on this pool. The first thrown exception is rethrown here.
+         */
+        template <typename Function>
+        inline void parallel_for(std::size_t begin, std::size_t end, Function&& function) {
+            if (begin >= end)
+                return;
+
+            struct State {
+                std::atomic<std::size_t> next;
+                std::atomic<std::size_t> remaining;
+                std::exception_ptr exception;
+                std::mutex mutex;
+                std::condition_variable condition;
+            };
+
+            auto state = std::make_shared<State>();
+            state->next = begin;
+            state->remaining = end - begin;
+
+            auto run = [state, end, &function] {
+                for (auto index = state->next++; index < end; index = state->next++) {
+                    try {
+                        function(index);
+                    } catch (...) {
+                        std::lock_guard lock(state->mutex);
+                        if (!state->exception)
+                            state->exception = std::current_exception();
+                    }
+
+                    if (--state->remaining == 0) {
+                        std::lock_guard lock(state->mutex);
+                        state->condition.notify_all();
+                    }
+                }
+            };
+
+            const auto helpers = std::min(size(), end - begin - 1);
+
+            {
+                std::lock_guard lock(m_mutex);
+                for (std::size_t index = 0; index < helpers; index++)
+                    m_tasks.emplace_back(run);
+            }
+
+            m_condition.notify_all();
+
+            run();
+
+            std::unique_lock lock(state->mutex);
+            state->condition.wait(lock, [&] { return state->remaining == 0; });
+
+            if (state->exception)
+                std::rethrow_exception(state->exception);
+        }
+
+    private:
+        inline void worker() {
+            while (true) {
+                std::function<void()> task;
+
+                {
+                    std::unique_lock lock(m_mutex);
+                    m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+                    if (m_stopping && m_tasks.empty())
+                        return;
+
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+
+                task();
+            }
+        }
+
+        std::vector<std::thread> m_threads;
+        std::deque<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping { false };
+    };
+}
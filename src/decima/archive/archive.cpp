@@ -1,74 +1,108 @@
 #include "decima/archive/archive.hpp"
 #include "decima/shared.hpp"
 
-#include <fstream>
-#include <MurmurHash3.h>
-
-static void decrypt(uint32_t key_1, uint32_t key_2, uint32_t* data) {
-    const std::uint32_t key[8] = {
-        key_1, Decima::plain_cipher_key[1], Decima::plain_cipher_key[2], Decima::plain_cipher_key[3],
-        key_2, Decima::plain_cipher_key[1], Decima::plain_cipher_key[2], Decima::plain_cipher_key[3]
-    };
-
-    std::uint32_t iv[8];
-    MurmurHash3_x64_128(key, 16, Decima::cipher_seed, iv);
-    MurmurHash3_x64_128(key + 4, 16, Decima::cipher_seed, iv + 4);
-
-    data[0] ^= iv[0];
-    data[1] ^= iv[1];
-    data[2] ^= iv[2];
-    data[3] ^= iv[3];
-    data[4] ^= iv[4];
-    data[5] ^= iv[5];
-    data[6] ^= iv[6];
-    data[7] ^= iv[7];
-}
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+static_assert(sizeof(Decima::ArchiveFileEntry) == 32, "File entries are decrypted as 32-byte blocks");
+static_assert(sizeof(Decima::ArchiveChunkEntry) == 32, "Chunk entries are decrypted as 32-byte blocks");
 
 Decima::Archive::Archive(const std::string& path)
-    : m_file(std::make_unique<std::ifstream>(path, std::ios::binary))
-    , path(path) { open(); }
+    : path(path)
+    , m_file(path) { }
+
+bool Decima::Archive::open(ash::thread_pool& workers) {
+    auto buffer = m_file.view();
 
-bool Decima::Archive::open() {
-    m_file->seekg(0, std::ios::beg);
-    m_file->read((char*)&header, sizeof(ArchiveHeader));
+    if (buffer.size() < sizeof(ArchiveHeader))
+        return false;
+
+    header = buffer.get<ArchiveHeader>();
 
     if (header.type != ArchiveType::Regular && header.type != ArchiveType::Encrypted)
         return false;
 
     if (header.type == ArchiveType::Encrypted)
-        decrypt(header.key, header.key + 1, (uint32_t*)&header.file_size);
+        decrypt_block(&header.file_size, header.key, header.key + 1);
+
+    /* Chunks are looked up by dividing offsets by their maximum size, see below */
+    if (header.chunk_maximum_size == 0)
+        return false;
 
     file_entries.resize(header.file_entries_count);
-    m_file->read((char*)file_entries.data(), sizeof(ArchiveFileEntry) * header.file_entries_count);
+    buffer.get(file_entries);
 
     chunk_entries.resize(header.chunk_entries_count);
-    m_file->read((char*)chunk_entries.data(), sizeof(ArchiveChunkEntry) * header.chunk_entries_count);
+    buffer.get(chunk_entries);
 
     if (header.type == ArchiveType::Encrypted) {
-        for (auto& entry : file_entries) {
-            uint32_t key_1 = entry.key;
-            uint32_t key_2 = entry.span.key;
+        constexpr std::size_t entries_per_batch = 4096;
+
+        const auto decrypt_entries = [&](auto& entries, std::size_t key_1_offset, std::size_t key_2_offset) {
+            workers.parallel_for(0, (entries.size() + entries_per_batch - 1) / entries_per_batch, [&](std::size_t batch) {
+                const auto batch_begin = batch * entries_per_batch;
+                decrypt_table(entries.data() + batch_begin, std::min(entries_per_batch, entries.size() - batch_begin), key_1_offset, key_2_offset);
+            });
+        };
+
+        decrypt_entries(file_entries, offsetof(ArchiveFileEntry, key), offsetof(ArchiveFileEntry, span) + offsetof(ArchiveSpan, key));
+        decrypt_entries(chunk_entries, offsetof(ArchiveChunkEntry, decompressed_span) + offsetof(ArchiveSpan, key), offsetof(ArchiveChunkEntry, compressed_span) + offsetof(ArchiveSpan, key));
+    }
+
+    /*
+     * Every chunk starts at an offset aligned to the maximum
+     * chunk size, so the chunk covering any decompressed offset
+     * can be found by dividing the offset by that size. Archives
+     * whose chunks are laid out differently are not supported.
+     */
+    for (std::size_t index = 0, expected_offset = 0; index < chunk_entries.size(); index++) {
+        const auto& span = chunk_entries[index].decompressed_span;
 
-            decrypt(entry.key, entry.span.key, (uint32_t*)&entry);
+        if (span.offset != expected_offset || span.offset % header.chunk_maximum_size != 0 || span.size > header.chunk_maximum_size)
+            return false;
 
-            entry.key = key_1;
-            entry.span.key = key_2;
-        }
+        expected_offset += span.size;
+    }
 
-        for (auto& entry : chunk_entries) {
-            uint32_t key_1 = entry.decompressed_span.key;
-            uint32_t key_2 = entry.compressed_span.key;
+    m_chunk_index.assign((header.data_size + header.chunk_maximum_size - 1) / header.chunk_maximum_size, std::numeric_limits<std::uint32_t>::max());
 
-            decrypt(entry.decompressed_span.key, entry.compressed_span.key, (uint32_t*)&entry);
+    for (std::size_t index = 0; index < chunk_entries.size(); index++) {
+        const auto slot = chunk_entries.at(index).decompressed_span.offset / header.chunk_maximum_size;
 
-            entry.decompressed_span.key = key_1;
-            entry.compressed_span.key = key_2;
-        }
+        if (slot < m_chunk_index.size())
+            m_chunk_index[slot] = static_cast<std::uint32_t>(index);
     }
 
-    for (std::size_t index = 0; index < file_entries.size(); index++) {
-        m_hash_to_index.emplace(file_entries.at(index).hash, index);
+    if (header.type == ArchiveType::Encrypted) {
+        constexpr std::size_t keys_per_batch = 4096;
+
+        chunk_keys.resize(chunk_entries.size());
+
+        workers.parallel_for(0, (chunk_entries.size() + keys_per_batch - 1) / keys_per_batch, [&](std::size_t batch) {
+            const auto batch_end = std::min(chunk_entries.size(), (batch + 1) * keys_per_batch);
+
+            for (auto index = batch * keys_per_batch; index < batch_end; index++)
+                chunk_keys[index] = derive_chunk_key(chunk_entries[index]);
+        });
     }
 
     return true;
 }
+
+std::pair<std::size_t, std::size_t> Decima::Archive::chunk_range(std::uint64_t offset, std::uint64_t size) const {
+    /* Empty spans, e.g. of empty files, may lie right at the end of the data */
+    if (size == 0)
+        return { 0, 0 };
+
+    const auto first_slot = offset / header.chunk_maximum_size;
+    const auto last_slot = (offset + size - 1) / header.chunk_maximum_size;
+
+    constexpr auto missing_chunk = std::numeric_limits<std::uint32_t>::max();
+
+    if (last_slot >= m_chunk_index.size() || m_chunk_index[first_slot] == missing_chunk || m_chunk_index[last_slot] == missing_chunk || m_chunk_index[first_slot] > m_chunk_index[last_slot])
+        throw std::out_of_range("Span is not covered by chunks of archive '" + path + "'");
+
+    return { m_chunk_index[first_slot], m_chunk_index[last_slot] + std::size_t(1) };
+}
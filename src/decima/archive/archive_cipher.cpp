@@ -0,0 +1,340 @@
+#include "decima/archive/archive_cipher.hpp"
+#include "decima/archive/archive.hpp"
+#include "decima/shared.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <md5.h>
+#include <MurmurHash3.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+    #define DECIMA_CIPHER_X86
+    #include <immintrin.h>
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define DECIMA_TARGET(_Target)
+    #else
+        #define DECIMA_TARGET(_Target) __attribute__((target(_Target)))
+    #endif
+#endif
+
+using DecryptFn = void (*)(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, const Decima::ChunkKey& key);
+using TableIvFn = void (*)(const std::uint32_t* keys, std::uint64_t* ivs, std::size_t count);
+
+Decima::ChunkKey Decima::derive_chunk_key(const ArchiveChunkEntry& chunk) {
+    uint32_t iv[4];
+    MurmurHash3_x64_128(&chunk, 0x10, Decima::cipher_seed, iv);
+
+    iv[0] ^= Decima::chunk_cipher_key[0];
+    iv[1] ^= Decima::chunk_cipher_key[1];
+    iv[2] ^= Decima::chunk_cipher_key[2];
+    iv[3] ^= Decima::chunk_cipher_key[3];
+
+    ChunkKey digest;
+    md5Hash((md5_byte_t*)iv, 16, digest.data());
+    return digest;
+}
+
+/*
+ * All kernels process whole 16-byte blocks only, so the key
+ * stays aligned with the data regardless of the vector width
+ * and the remainder is left for the generic kernel.
+ */
+
+static void decrypt_generic(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, const Decima::ChunkKey& key) {
+    std::uint64_t key_8[2];
+    std::memcpy(key_8, key.data(), sizeof(key_8));
+
+    std::size_t offset = 0;
+
+    for (; offset + 16 <= size; offset += 16) {
+        std::uint64_t block[2];
+        std::memcpy(block, src + offset, sizeof(block));
+        block[0] ^= key_8[0];
+        block[1] ^= key_8[1];
+        std::memcpy(dst + offset, block, sizeof(block));
+    }
+
+    for (; offset < size; offset++) {
+        dst[offset] = src[offset] ^ key[offset % 16];
+    }
+}
+
+/*
+ * Every table key is hashed with MurmurHash3_x64_128 from 16 bytes where
+ * only the first word varies, so the hash is unrolled for exactly this
+ * input, and its constant parts are folded at compile time.
+ */
+
+static constexpr std::uint64_t murmur_c1 = 0x87c37b91114253d5;
+static constexpr std::uint64_t murmur_c2 = 0x4cf5ad432745937f;
+
+static constexpr std::uint64_t rotl64(std::uint64_t value, int shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+static constexpr std::uint64_t fmix64(std::uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccd;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53;
+    value ^= value >> 33;
+    return value;
+}
+
+static constexpr std::uint64_t table_seed = Decima::cipher_seed;
+static constexpr std::uint64_t table_k1_high = std::uint64_t(Decima::plain_cipher_key[1]) << 32;
+static constexpr std::uint64_t table_h2_base = rotl64(table_seed ^ (rotl64((Decima::plain_cipher_key[2] | std::uint64_t(Decima::plain_cipher_key[3]) << 32) * murmur_c2, 33) * murmur_c1), 31);
+
+static void table_iv_generic(const std::uint32_t* keys, std::uint64_t* ivs, std::size_t count) {
+    for (std::size_t index = 0; index < count; index++) {
+        auto h1 = table_seed ^ (rotl64((table_k1_high | keys[index]) * murmur_c1, 31) * murmur_c2);
+        h1 = (rotl64(h1, 27) + table_seed) * 5 + 0x52dce729;
+        auto h2 = (table_h2_base + h1) * 5 + 0x38495ab5;
+
+        h1 ^= 16;
+        h2 ^= 16;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix64(h1);
+        h2 = fmix64(h2);
+        h1 += h2;
+        h2 += h1;
+
+        ivs[index * 2 + 0] = h1;
+        ivs[index * 2 + 1] = h2;
+    }
+}
+
+#ifdef DECIMA_CIPHER_X86
+static void decrypt_sse2(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, const Decima::ChunkKey& key) {
+    const auto key_16 = _mm_loadu_si128((const __m128i*)key.data());
+    std::size_t offset = 0;
+
+    for (; offset + 16 <= size; offset += 16) {
+        const auto block = _mm_loadu_si128((const __m128i*)(src + offset));
+        _mm_storeu_si128((__m128i*)(dst + offset), _mm_xor_si128(block, key_16));
+    }
+
+    decrypt_generic(src + offset, dst + offset, size - offset, key);
+}
+
+DECIMA_TARGET("avx2")
+static void decrypt_avx2(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, const Decima::ChunkKey& key) {
+    const auto key_32 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)key.data()));
+    std::size_t offset = 0;
+
+    for (; offset + 32 <= size; offset += 32) {
+        const auto block = _mm256_loadu_si256((const __m256i*)(src + offset));
+        _mm256_storeu_si256((__m256i*)(dst + offset), _mm256_xor_si256(block, key_32));
+    }
+
+    decrypt_sse2(src + offset, dst + offset, size - offset, key);
+}
+
+DECIMA_TARGET("avx512f")
+static void decrypt_avx512(const std::uint8_t* src, std::uint8_t* dst, std::size_t size, const Decima::ChunkKey& key) {
+    const auto key_64 = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)key.data()));
+    std::size_t offset = 0;
+
+    for (; offset + 64 <= size; offset += 64) {
+        const auto block = _mm512_loadu_si512((const void*)(src + offset));
+        _mm512_storeu_si512((void*)(dst + offset), _mm512_xor_si512(block, key_64));
+    }
+
+    decrypt_avx2(src + offset, dst + offset, size - offset, key);
+}
+
+/* AVX2 has no 64-bit multiplication, so it is assembled from 32-bit halves */
+DECIMA_TARGET("avx2")
+static inline __m256i mul64_avx2(__m256i value, std::uint64_t factor) {
+    const auto factor_lo = _mm256_set1_epi64x(factor & 0xffffffff);
+    const auto factor_hi = _mm256_set1_epi64x(factor >> 32);
+    const auto cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(value, 32), factor_lo), _mm256_mul_epu32(value, factor_hi));
+    return _mm256_add_epi64(_mm256_mul_epu32(value, factor_lo), _mm256_slli_epi64(cross, 32));
+}
+
+DECIMA_TARGET("avx2")
+static inline __m256i rotl64_avx2(__m256i value, int shift) {
+    return _mm256_or_si256(_mm256_slli_epi64(value, shift), _mm256_srli_epi64(value, 64 - shift));
+}
+
+DECIMA_TARGET("avx2")
+static inline __m256i fmix64_avx2(__m256i value) {
+    value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 33));
+    value = mul64_avx2(value, 0xff51afd7ed558ccd);
+    value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 33));
+    value = mul64_avx2(value, 0xc4ceb9fe1a85ec53);
+    value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 33));
+    return value;
+}
+
+DECIMA_TARGET("avx2")
+static void table_iv_avx2(const std::uint32_t* keys, std::uint64_t* ivs, std::size_t count) {
+    const auto seed = _mm256_set1_epi64x(table_seed);
+    const auto length = _mm256_set1_epi64x(16);
+    std::size_t index = 0;
+
+    for (; index + 4 <= count; index += 4) {
+        const auto k1 = _mm256_or_si256(_mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(keys + index))), _mm256_set1_epi64x(table_k1_high));
+
+        auto h1 = _mm256_xor_si256(seed, mul64_avx2(rotl64_avx2(mul64_avx2(k1, murmur_c1), 31), murmur_c2));
+        h1 = _mm256_add_epi64(mul64_avx2(_mm256_add_epi64(rotl64_avx2(h1, 27), seed), 5), _mm256_set1_epi64x(0x52dce729));
+        auto h2 = _mm256_add_epi64(mul64_avx2(_mm256_add_epi64(_mm256_set1_epi64x(table_h2_base), h1), 5), _mm256_set1_epi64x(0x38495ab5));
+
+        h1 = _mm256_xor_si256(h1, length);
+        h2 = _mm256_xor_si256(h2, length);
+        h1 = _mm256_add_epi64(h1, h2);
+        h2 = _mm256_add_epi64(h2, h1);
+        h1 = fmix64_avx2(h1);
+        h2 = fmix64_avx2(h2);
+        h1 = _mm256_add_epi64(h1, h2);
+        h2 = _mm256_add_epi64(h2, h1);
+
+        /* Interleave lanes back into (h1, h2) pairs */
+        const auto lo = _mm256_unpacklo_epi64(h1, h2);
+        const auto hi = _mm256_unpackhi_epi64(h1, h2);
+        _mm256_storeu_si256((__m256i*)(ivs + index * 2 + 0), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(ivs + index * 2 + 4), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    table_iv_generic(keys + index, ivs + index * 2, count - index);
+}
+
+DECIMA_TARGET("avx512f,avx512dq")
+static inline __m512i fmix64_avx512(__m512i value) {
+    value = _mm512_xor_si512(value, _mm512_srli_epi64(value, 33));
+    value = _mm512_mullo_epi64(value, _mm512_set1_epi64(0xff51afd7ed558ccd));
+    value = _mm512_xor_si512(value, _mm512_srli_epi64(value, 33));
+    value = _mm512_mullo_epi64(value, _mm512_set1_epi64(0xc4ceb9fe1a85ec53));
+    value = _mm512_xor_si512(value, _mm512_srli_epi64(value, 33));
+    return value;
+}
+
+DECIMA_TARGET("avx512f,avx512dq")
+static void table_iv_avx512(const std::uint32_t* keys, std::uint64_t* ivs, std::size_t count) {
+    const auto seed = _mm512_set1_epi64(table_seed);
+    const auto length = _mm512_set1_epi64(16);
+    std::size_t index = 0;
+
+    for (; index + 8 <= count; index += 8) {
+        const auto k1 = _mm512_or_si512(_mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*)(keys + index))), _mm512_set1_epi64(table_k1_high));
+
+        auto h1 = _mm512_xor_si512(seed, _mm512_mullo_epi64(_mm512_rol_epi64(_mm512_mullo_epi64(k1, _mm512_set1_epi64(murmur_c1)), 31), _mm512_set1_epi64(murmur_c2)));
+        h1 = _mm512_add_epi64(_mm512_mullo_epi64(_mm512_add_epi64(_mm512_rol_epi64(h1, 27), seed), _mm512_set1_epi64(5)), _mm512_set1_epi64(0x52dce729));
+        auto h2 = _mm512_add_epi64(_mm512_mullo_epi64(_mm512_add_epi64(_mm512_set1_epi64(table_h2_base), h1), _mm512_set1_epi64(5)), _mm512_set1_epi64(0x38495ab5));
+
+        h1 = _mm512_xor_si512(h1, length);
+        h2 = _mm512_xor_si512(h2, length);
+        h1 = _mm512_add_epi64(h1, h2);
+        h2 = _mm512_add_epi64(h2, h1);
+        h1 = fmix64_avx512(h1);
+        h2 = fmix64_avx512(h2);
+        h1 = _mm512_add_epi64(h1, h2);
+        h2 = _mm512_add_epi64(h2, h1);
+
+        /* Interleave lanes back into (h1, h2) pairs */
+        _mm512_storeu_si512((void*)(ivs + index * 2 + 0), _mm512_permutex2var_epi64(h1, _mm512_setr_epi64(0, 8, 1, 9, 2, 10, 3, 11), h2));
+        _mm512_storeu_si512((void*)(ivs + index * 2 + 8), _mm512_permutex2var_epi64(h1, _mm512_setr_epi64(4, 12, 5, 13, 6, 14, 7, 15), h2));
+    }
+
+    table_iv_avx2(keys + index, ivs + index * 2, count - index);
+}
+
+static bool cpu_supports(int leaf_7_ebx_bit, [[maybe_unused]] std::uint64_t os_state_mask) {
+    #ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    const bool os_saves_state = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & os_state_mask) == os_state_mask;
+    __cpuidex(info, 7, 0);
+    return os_saves_state && (info[1] & (1 << leaf_7_ebx_bit)) != 0;
+    #else
+    switch (leaf_7_ebx_bit) {
+    case 5:
+        return __builtin_cpu_supports("avx2");
+    case 16:
+        return __builtin_cpu_supports("avx512f");
+    case 17:
+        return __builtin_cpu_supports("avx512dq");
+    default:
+        return false;
+    }
+    #endif
+}
+#endif
+
+static DecryptFn select_decrypt_kernel() {
+#ifdef DECIMA_CIPHER_X86
+    /* XCR0: SSE | AVX state, plus opmask and upper ZMM state for AVX-512 */
+    if (cpu_supports(16, 0xe6))
+        return decrypt_avx512;
+    if (cpu_supports(5, 0x06))
+        return decrypt_avx2;
+    return decrypt_sse2;
+#else
+    return decrypt_generic;
+#endif
+}
+
+static TableIvFn select_table_kernel() {
+#ifdef DECIMA_CIPHER_X86
+    if (cpu_supports(16, 0xe6) && cpu_supports(17, 0xe6))
+        return table_iv_avx512;
+    if (cpu_supports(5, 0x06))
+        return table_iv_avx2;
+#endif
+    return table_iv_generic;
+}
+
+static void xor_entry(std::uint8_t* entry, const std::uint64_t* ivs) {
+    std::uint64_t block[4];
+    std::memcpy(block, entry, sizeof(block));
+    block[0] ^= ivs[0];
+    block[1] ^= ivs[1];
+    block[2] ^= ivs[2];
+    block[3] ^= ivs[3];
+    std::memcpy(entry, block, sizeof(block));
+}
+
+void Decima::decrypt_block(void* data, std::uint32_t key_1, std::uint32_t key_2) {
+    const std::uint32_t keys[2] = { key_1, key_2 };
+    std::uint64_t ivs[4];
+
+    table_iv_generic(keys, ivs, 2);
+    xor_entry(static_cast<std::uint8_t*>(data), ivs);
+}
+
+void Decima::decrypt_table(void* entries, std::size_t count, std::size_t key_1_offset, std::size_t key_2_offset) {
+    static const TableIvFn kernel = select_table_kernel();
+    constexpr std::size_t entry_size = 32;
+    constexpr std::size_t batch_size = 64;
+
+    std::uint32_t keys[batch_size * 2];
+    std::uint64_t ivs[batch_size * 4];
+
+    for (std::size_t begin = 0; begin < count; begin += batch_size) {
+        const auto batch = std::min(batch_size, count - begin);
+        const auto batch_entries = static_cast<std::uint8_t*>(entries) + begin * entry_size;
+
+        for (std::size_t index = 0; index < batch; index++) {
+            std::memcpy(&keys[index * 2 + 0], batch_entries + index * entry_size + key_1_offset, sizeof(std::uint32_t));
+            std::memcpy(&keys[index * 2 + 1], batch_entries + index * entry_size + key_2_offset, sizeof(std::uint32_t));
+        }
+
+        kernel(keys, ivs, batch * 2);
+
+        for (std::size_t index = 0; index < batch; index++) {
+            const auto entry = batch_entries + index * entry_size;
+            xor_entry(entry, ivs + index * 4);
+            std::memcpy(entry + key_1_offset, &keys[index * 2 + 0], sizeof(std::uint32_t));
+            std::memcpy(entry + key_2_offset, &keys[index * 2 + 1], sizeof(std::uint32_t));
+        }
+    }
+}
+
+void Decima::decrypt_chunk(const void* src, void* dst, std::size_t size, const ChunkKey& key) {
+    static const DecryptFn kernel = select_decrypt_kernel();
+    kernel(static_cast<const std::uint8_t*>(src), static_cast<std::uint8_t*>(dst), size, key);
+}
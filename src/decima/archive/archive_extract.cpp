@@ -0,0 +1,140 @@
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include "decima/archive/archive_manager.hpp"
+#include "util/read_engine.hpp"
+
+namespace {
+    struct ExtractFile {
+        std::uint64_t hash;
+        ash::shared_buffer contents;
+        std::size_t contents_offset;
+        std::size_t contents_size;
+    };
+
+    struct ExtractChunk {
+        const Decima::Archive* archive;
+        std::size_t chunk_index;
+        std::size_t file;
+        char* output;
+        std::size_t read_offset;
+    };
+}
+
+void Decima::ArchiveManager::extract_files(const std::vector<std::uint64_t>& hashes, const std::function<void(std::uint64_t, const ash::shared_buffer&)>& callback) {
+    ash::read_engine engine;
+
+    std::vector<ExtractFile> files;
+    std::vector<ExtractChunk> chunks;
+    std::vector<ash::read_request> requests;
+    std::vector<char> compressed;
+
+    for (std::size_t hash_index = 0; hash_index < hashes.size();) {
+        files.clear();
+        chunks.clear();
+        requests.clear();
+
+        std::size_t batch_size = 0;
+
+        /* Take as many files as fit into a batch, but always at least one */
+        for (; hash_index < hashes.size(); hash_index++) {
+            const auto location = file_index.find(hashes[hash_index]);
+
+            if (location == nullptr)
+                continue;
+
+            const auto& archive = archives[location->archive];
+            const auto& entry = archive.file_entries[location->entry];
+
+            /* Empty files have no chunks to wait for */
+            if (entry.span.size == 0) {
+                callback(hashes[hash_index], {});
+                continue;
+            }
+
+            const auto [chunk_index_begin, chunk_index_end] = archive.chunk_range(entry.span.offset, entry.span.size);
+
+            std::size_t file_compressed_size = 0;
+            std::size_t file_decompressed_size = 0;
+
+            for (auto index = chunk_index_begin; index < chunk_index_end; index++) {
+                file_compressed_size += archive.chunk_entries[index].compressed_span.size;
+                file_decompressed_size += archive.chunk_entries[index].decompressed_span.size;
+            }
+
+            if (!files.empty() && batch_size + file_compressed_size > extract_batch_size)
+                break;
+
+            auto [contents, contents_data] = ash::shared_buffer::allocate(file_decompressed_size);
+
+            for (auto index = chunk_index_begin; index < chunk_index_end; index++) {
+                const auto& chunk = archive.chunk_entries[index];
+                chunks.push_back({ &archive, index, files.size(), contents_data, batch_size });
+                contents_data += chunk.decompressed_span.size;
+                batch_size += chunk.compressed_span.size;
+            }
+
+            files.push_back({ hashes[hash_index], std::move(contents), entry.span.offset - archive.chunk_entries[chunk_index_begin].decompressed_span.offset, entry.span.size });
+        }
+
+        compressed.resize(batch_size);
+
+        for (const auto& chunk : chunks) {
+            const auto& span = chunk.archive->chunk_entries[chunk.chunk_index].compressed_span;
+            requests.push_back({ chunk.archive->m_file.native_handle(), span.offset, span.size, compressed.data() + chunk.read_offset });
+        }
+
+        std::unique_ptr<std::atomic<std::size_t>[]> remaining_chunks(new std::atomic<std::size_t>[files.size()]);
+
+        for (std::size_t index = 0; index < files.size(); index++)
+            remaining_chunks[index] = 0;
+        for (const auto& chunk : chunks)
+            remaining_chunks[chunk.file]++;
+
+        const auto process_chunk = [&](std::size_t index) {
+            const auto& chunk = chunks[index];
+            const auto& archive = *chunk.archive;
+            const auto& entry = archive.chunk_entries[chunk.chunk_index];
+            const auto chunk_data = compressed.data() + chunk.read_offset;
+
+            if (archive.header.type == ArchiveType::Encrypted)
+                decrypt_chunk(chunk_data, chunk_data, entry.compressed_span.size, archive.chunk_keys[chunk.chunk_index]);
+
+            if (compressor->decompress(chunk_data, entry.compressed_span.size, chunk.output, entry.decompressed_span.size) != entry.decompressed_span.size)
+                throw std::runtime_error("Cannot decompress chunk at offset " + std::to_string(entry.compressed_span.offset) + " of archive '" + archive.path + "'");
+
+            if (--remaining_chunks[chunk.file] == 0) {
+                const auto& file = files[chunk.file];
+                callback(file.hash, file.contents.slice(file.contents_offset, file.contents_size));
+            }
+        };
+
+        /*
+         * Every chunk is handed to the worker pool as soon as it is read,
+         * while the rest of the batch is still in flight. All of them must
+         * be finished before buffers of this batch can be reused.
+         */
+        std::vector<std::future<void>> pending;
+        pending.reserve(chunks.size());
+
+        const auto wait_pending = [&] {
+            for (auto& future : pending)
+                future.wait();
+        };
+
+        try {
+            engine.read(requests, [&](std::size_t index) {
+                pending.push_back(workers->submit([&process_chunk, index] { process_chunk(index); }));
+            });
+        } catch (...) {
+            wait_pending();
+            throw;
+        }
+
+        wait_pending();
+
+        for (auto& future : pending)
+            future.get();
+    }
+}
@@ -1,137 +1,601 @@
 #include "decima/archive/archive_file.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <numeric>
-
-#include <md5.h>
-#include <MurmurHash3.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 #include "decima/archive/archive.hpp"
 #include "decima/archive/archive_manager.hpp"
 #include "decima/serializable/object/object.hpp"
 #include "decima/serializable/handlers.hpp"
 #include "decima/serializable/reference.hpp"
+#include "util/arena.hpp"
+#include "utils.hpp"
 
-static void decrypt_chunk(uint8_t* data, const Decima::ArchiveChunkEntry& chunk_entry) {
-    uint32_t iv[4];
-    MurmurHash3_x64_128(&chunk_entry, 0x10, Decima::cipher_seed, iv);
+/*
+ * Chunks of regular archives are fed to the compressor right
+ * from the mapping, encrypted ones are decrypted into given
+ * scratch buffer first, since the mapping is read-only.
+ */
+static ash::buffer read_chunk(const Decima::Archive& archive, std::size_t chunk_index, const ash::mapped_file& source, char* scratch) {
+    const auto& chunk = archive.chunk_entries[chunk_index];
+    const auto chunk_data = source.view(chunk.compressed_span.offset, chunk.compressed_span.size);
 
-    iv[0] ^= Decima::chunk_cipher_key[0];
-    iv[1] ^= Decima::chunk_cipher_key[1];
-    iv[2] ^= Decima::chunk_cipher_key[2];
-    iv[3] ^= Decima::chunk_cipher_key[3];
+    if (archive.header.type != Decima::ArchiveType::Encrypted)
+        return chunk_data;
 
-    uint8_t digest[16];
-    md5Hash((md5_byte_t*)iv, 16, digest);
-    for (uint32_t i = 0; i < chunk_entry.compressed_span.size; i++) {
-        data[i] ^= digest[i % 16];
-    }
+    Decima::decrypt_chunk(chunk_data.data(), scratch, chunk_data.size(), archive.chunk_keys[chunk_index]);
+    return { scratch, chunk_data.size() };
 }
 
-std::vector<char> unpack(Decima::Compressor& compressor, const Decima::Archive& archive, const Decima::ArchiveFileEntry& entry, std::ifstream& source) {
-    auto aligned_offset = [](std::uint64_t offset, std::uint64_t alignment) {
-        return offset & ~(alignment - 1);
+static void decompress_chunk(const Decima::Compressor& compressor, const Decima::Archive& archive, std::size_t chunk_index, const ash::mapped_file& source, char* output) {
+    const auto& chunk = archive.chunk_entries[chunk_index];
+
+    thread_local std::vector<char> scratch;
+    scratch.resize(chunk.compressed_span.size);
+
+    const auto chunk_data = read_chunk(archive, chunk_index, source, scratch.data());
+
+    if (compressor.decompress(chunk_data.data(), chunk_data.size(), output, chunk.decompressed_span.size) != chunk.decompressed_span.size)
+        throw std::runtime_error("Cannot decompress chunk at offset " + std::to_string(chunk.compressed_span.offset) + " of archive '" + archive.path + "'");
+}
+
+/*
+ * Slices keep the whole buffer they point into alive, so spans that
+ * cover less than half of it are copied out instead, which bounds the
+ * memory a file keeps alive to twice its size.
+ */
+static ash::shared_buffer slice_buffer(const ash::shared_buffer& buffer, std::size_t offset, std::size_t size) {
+    if (size >= buffer.capacity() / 2)
+        return buffer.slice(offset, size);
+
+    auto [result, result_data] = ash::shared_buffer::allocate(size);
+    std::memcpy(result_data, buffer.data() + offset, size);
+    return result;
+}
+
+/*
+ * Unpacks given span of decompressed data of the archive, which is either a whole
+ * file or a part of it. Only chunks that overlap the span are read and decompressed.
+ */
+static ash::shared_buffer unpack(Decima::ArchiveManager& manager, const Decima::Archive& archive, std::uint64_t offset, std::uint64_t size, const ash::mapped_file& source) {
+    if (size == 0)
+        return {};
+
+    const auto [chunk_index_begin, chunk_index_end] = archive.chunk_range(offset, size);
+    const auto result_buffer_offset = offset - archive.chunk_entries[chunk_index_begin].decompressed_span.offset;
+
+    /*
+     * A span that fits into a single chunk is returned as
+     * a view into that chunk, which is shared through the
+     * cache with all neighbouring files, unless it only
+     * covers a small part of the chunk.
+     */
+    if (chunk_index_end - chunk_index_begin == 1) {
+        const auto& chunk = archive.chunk_entries[chunk_index_begin];
+        auto chunk_buffer = manager.chunk_cache->find(chunk);
+
+        if (!chunk_buffer) {
+            auto [buffer, buffer_data] = ash::shared_buffer::allocate(chunk.decompressed_span.size);
+            decompress_chunk(*manager.compressor, archive, chunk_index_begin, source, buffer_data);
+            manager.chunk_cache->insert(chunk, buffer);
+            chunk_buffer = std::move(buffer);
+        }
+
+        return slice_buffer(chunk_buffer, result_buffer_offset, size);
+    }
+
+    std::size_t result_buffer_size = 0;
+
+    for (auto index = chunk_index_begin; index < chunk_index_end; index++)
+        result_buffer_size += archive.chunk_entries[index].decompressed_span.size;
+
+    auto [result_buffer, result_buffer_data] = ash::shared_buffer::allocate(result_buffer_size);
+
+    /*
+     * Only the first and the last chunks of a span can be
+     * shared with neighbouring files, the ones in between
+     * belong to this span alone and are not worth caching.
+     */
+    const auto is_chunk_shared = [&](std::size_t index) {
+        return index == chunk_index_begin || index + 1 == chunk_index_end;
     };
 
-    auto chunk_from_offset = [&](std::uint64_t offset) {
-        return std::find_if(archive.chunk_entries.begin(), archive.chunk_entries.end(), [&](const auto& item) {
-            return item.decompressed_span.offset == offset;
-        });
+    std::vector<std::size_t> task_chunks;
+    std::vector<char*> chunk_outputs;
+    std::size_t chunk_output_offset = 0;
+
+    for (auto index = chunk_index_begin; index < chunk_index_end; index++) {
+        const auto& chunk = archive.chunk_entries[index];
+        const auto chunk_output = result_buffer_data + chunk_output_offset;
+        chunk_output_offset += chunk.decompressed_span.size;
+
+        if (const auto cached = is_chunk_shared(index) ? manager.chunk_cache->find(chunk) : ash::shared_buffer()) {
+            std::memcpy(chunk_output, cached.data(), cached.size());
+            continue;
+        }
+
+        task_chunks.push_back(index);
+        chunk_outputs.push_back(chunk_output);
+    }
+
+    /*
+     * Chunks are processed in windows, so while one window is decrypted
+     * and decompressed, the system already reads the next one in
+     * background. Chunks are independent units that decompress into
+     * their own slots of the output buffer, so each of them is decrypted
+     * and decompressed by its own task on the worker pool.
+     */
+    const auto window_size = std::max<std::size_t>(manager.unpack_window, 1);
+    const bool parallel = manager.parallel_unpack_threshold > 0 && task_chunks.size() >= manager.parallel_unpack_threshold;
+
+    const auto prefetch_window = [&](std::size_t window_begin) {
+        for (auto task = window_begin; task < std::min(window_begin + window_size, task_chunks.size()); task++) {
+            const auto& span = archive.chunk_entries[task_chunks[task]].compressed_span;
+            source.prefetch(span.offset, span.size);
+        }
     };
 
-    auto [chunk_entry_begin, chunk_entry_end] = [&] {
-        auto first_chunk_offset = aligned_offset(entry.span.offset, archive.header.chunk_maximum_size);
-        auto last_chunk_offset = aligned_offset(entry.span.offset + entry.span.size, archive.header.chunk_maximum_size);
+    const auto unpack_chunk = [&](std::size_t task) {
+        decompress_chunk(*manager.compressor, archive, task_chunks[task], source, chunk_outputs[task]);
+    };
 
-        return std::make_pair(chunk_from_offset(first_chunk_offset), chunk_from_offset(last_chunk_offset) + 1);
-    }();
+    prefetch_window(0);
 
-    source.seekg(chunk_entry_begin->compressed_span.offset, std::ios::beg);
+    for (std::size_t window_begin = 0; window_begin < task_chunks.size(); window_begin += window_size) {
+        const auto window_end = std::min(window_begin + window_size, task_chunks.size());
 
-    std::size_t chunk_buffer_offset = 0;
-    std::vector<char> chunk_buffer;
+        prefetch_window(window_end);
 
-    std::size_t result_buffer_size = 0;
-    std::size_t result_buffer_offset = entry.span.offset & (archive.header.chunk_maximum_size - 1);
-    std::vector<char> result_buffer;
+        if (parallel) {
+            manager.workers->parallel_for(window_begin, window_end, unpack_chunk);
+        } else {
+            for (auto task = window_begin; task < window_end; task++)
+                unpack_chunk(task);
+        }
+    }
+
+    for (std::size_t task = 0; task < task_chunks.size(); task++) {
+        const auto& chunk = archive.chunk_entries[task_chunks[task]];
+
+        if (is_chunk_shared(task_chunks[task])) {
+            auto [buffer, buffer_data] = ash::shared_buffer::allocate(chunk.decompressed_span.size);
+            std::memcpy(buffer_data, chunk_outputs[task], chunk.decompressed_span.size);
+            manager.chunk_cache->insert(chunk, std::move(buffer));
+        }
+    }
+
+    return slice_buffer(result_buffer, result_buffer_offset, size);
+}
+
+ash::shared_buffer Decima::ArchiveManager::read_range(std::uint64_t hash, std::uint64_t offset, std::uint64_t length) {
+    const auto location = file_index.find(hash);
+
+    if (location == nullptr)
+        return {};
 
-    std::for_each(chunk_entry_begin, chunk_entry_end, [&] (const Decima::ArchiveChunkEntry& chunk) {
-        chunk_buffer.resize(chunk_buffer.size() + chunk.compressed_span.size);
-        source.read((char*)chunk_buffer.data() + chunk_buffer_offset, chunk.compressed_span.size);
-        if (archive.header.type == Decima::ArchiveType::Encrypted)
-            decrypt_chunk((uint8_t*)chunk_buffer.data() + chunk_buffer_offset, chunk);
-        chunk_buffer_offset += chunk.compressed_span.size;
-        result_buffer_size += chunk.decompressed_span.size;
-    });
+    const auto& archive = archives[location->archive];
+    const auto& entry = archive.file_entries[location->entry];
 
-    result_buffer.resize(result_buffer_size);
-    compressor.decompress(chunk_buffer, result_buffer);
+    if (offset > entry.span.size || length > entry.span.size - offset)
+        throw std::out_of_range("Range " + std::to_string(offset) + "+" + std::to_string(length) + " is outside of file of " + std::to_string(entry.span.size) + " bytes");
 
-    result_buffer.erase(result_buffer.begin(), result_buffer.begin() + result_buffer_offset);
-    result_buffer.erase(result_buffer.begin() + entry.span.size, result_buffer.end());
+    /* Empty ranges need no chunks, even at the very end of the data */
+    if (length == 0)
+        return {};
 
-    std::ofstream output("suka.bin", std::ios::binary | std::ios::trunc);
-    output.write(result_buffer.data(), result_buffer.size());
+    if (const auto file = file_cache->find(hash))
+        return file->contents.slice(offset, length);
 
-    return result_buffer;
+    return unpack(*this, archive, entry.span.offset + offset, length, archive.m_file);
 }
 
-Decima::CoreFile::CoreFile(Archive& archive, ArchiveManager& manager, ArchiveFileEntry& entry, std::ifstream& source)
-    : archive(archive)
-    , manager(manager)
+ash::shared_buffer Decima::ArchiveManager::read_range(const std::string& name, std::uint64_t offset, std::uint64_t length) {
+    return read_range(hash_string(sanitize_name(name), cipher_seed), offset, length);
+}
+
+Decima::CoreFile::CoreFile(const Archive& archive, ArchiveManager& manager, ArchiveFileEntry& entry, const ash::mapped_file& source)
+    : manager(manager)
     , entry(entry)
-    , contents(unpack(*manager.compressor, archive, entry, source)) { }
+    , contents(unpack(manager, archive, entry.span.offset, entry.span.size, source)) { }
+
+Decima::CoreFile::~CoreFile() {
+    /*
+     * References point back to their owners and often to each
+     * other, so these cycles must be broken for objects to be freed.
+     */
+    for (auto* ref : m_owned_references) {
+        ref->m_object.reset();
+        ref->m_owner.reset();
+    }
+
+    for (const auto& [guid, index] : m_object_indices)
+        manager.object_index->erase(guid, this);
+}
+
+std::size_t Decima::CoreFile::memory_usage() const {
+    /*
+     * Contents are charged with the whole buffer of chunks they may be a view into.
+     * The arena is assigned before the file is marked as parsed and never changes after that.
+     */
+    return m_parsed ? contents.capacity() + m_arena->size() + m_batch_arenas_size : contents.capacity();
+}
+
+std::vector<std::uint64_t> Decima::CoreFile::dependencies() const {
+    std::lock_guard lock(m_dependencies_mutex);
+    return m_dependencies;
+}
+
+namespace {
+    /* Makes given object current on this thread for the lifetime of the scope */
+    class CurrentObjectScope {
+    public:
+        explicit CurrentObjectScope(std::shared_ptr<Decima::CoreObject>& current, std::shared_ptr<Decima::CoreObject> object)
+            : m_current(current)
+            , m_previous(std::exchange(current, std::move(object))) { }
 
-void Decima::CoreFile::resolve_reference(const std::shared_ptr<CoreObject>& object) {
-    auto index = std::remove_if(references.begin(), references.end(), [&](Ref* ref) {
-        if (ref->m_guid.hash() == object->guid.hash()) {
-            ref->m_object = object;
-            return true;
+        ~CurrentObjectScope() {
+            m_current = std::move(m_previous);
         }
 
-        return false;
-    });
+    private:
+        std::shared_ptr<Decima::CoreObject>& m_current;
+        std::shared_ptr<Decima::CoreObject> m_previous;
+    };
+
+    /* Makes references queued on this thread go to given list for the lifetime of the scope */
+    class DeferredReferencesScope {
+    public:
+        explicit DeferredReferencesScope(std::vector<Decima::Ref*>*& current, std::vector<Decima::Ref*>& references)
+            : m_current(current)
+            , m_previous(std::exchange(current, &references)) { }
+
+        ~DeferredReferencesScope() {
+            m_current = m_previous;
+        }
 
-    references.erase(index, references.end());
+    private:
+        std::vector<Decima::Ref*>*& m_current;
+        std::vector<Decima::Ref*>* m_previous;
+    };
+
+    thread_local std::shared_ptr<Decima::CoreObject> current_parsed_object;
+    thread_local std::vector<Decima::Ref*>* deferred_references = nullptr;
 }
 
-void Decima::CoreFile::resolve_reference(const Decima::CoreFile& file) {
-    for (auto& [object, object_offset] : objects) {
-        resolve_reference(object);
-    }
+const std::shared_ptr<Decima::CoreObject>& Decima::CoreFile::current_object() noexcept {
+    return current_parsed_object;
 }
 
 void Decima::CoreFile::queue_reference(Decima::Ref* ref) {
+    /* Objects parsed in parallel collect their references apart, see parse_objects */
+    if (deferred_references != nullptr) {
+        deferred_references->push_back(ref);
+        return;
+    }
+
+    m_owned_references.push_back(ref);
+
     if (ref->mode() == RefLoadMode::NotPresent || ref->mode() == RefLoadMode::WorkOnly)
         return;
 
     if (ref->mode() == RefLoadMode::ImmediateCoreFile || ref->mode() == RefLoadMode::CoreFile) {
-        auto& file = manager.query_file(ref->file().data()).value().get();
-        file.references.push_back(ref);
-        file.parse();
+        m_external_references.push_back(ref);
     } else {
         references.push_back(ref);
     }
 }
 
+const std::vector<Decima::CoreObjectInfo>& Decima::CoreFile::index_objects() {
+    /* The table never changes once it's read, so it's returned without waiting for the file, e.g. while it's parsed */
+    if (m_parsed)
+        return m_object_table;
+
+    std::lock_guard lock(m_mutex);
+    read_object_table();
+
+    return m_object_table;
+}
+
+std::shared_ptr<Decima::CoreObject> Decima::CoreFile::object(std::size_t index) {
+    std::unique_lock lock(m_mutex);
+
+    read_object_table();
+
+    if (index >= m_object_table.size())
+        throw std::out_of_range("Object index " + std::to_string(index) + " is out of range");
+
+    /* Objects are stored once parsed, and they are complete once no references of the file are being resolved */
+    if (m_objects[index] != nullptr && !m_resolving && m_external_references.empty())
+        return m_objects[index];
+
+    finish_parse(lock, parse_objects({ index }), true);
+
+    lock.lock();
+    return m_objects[index];
+}
+
 void Decima::CoreFile::parse() {
-    if (objects.empty()) {
-        // TODO: This is shitty API I wrote, please replace this
-        ash::buffer buffer(contents.data(), contents.size());
-
-        while (buffer.size() > 0) {
-            const auto entry_header = Decima::CoreObject::peek_header(buffer);
-            const auto entry_offset = buffer.data() - contents.data();
-
-            /*
-             * Tricky hack to allow objects during parsing.
-             * This is useful for getting owner of the reference
-             */
-            auto handler = Decima::get_type_handler(entry_header.file_type);
-            objects.emplace_back(handler, entry_offset);
-            handler->parse(manager, buffer, *this);
+    parse([](const CoreObjectInfo&) { return true; }, true);
+}
+
+void Decima::CoreFile::parse(const CoreObjectFilter& filter) {
+    parse(filter, true);
+}
+
+void Decima::CoreFile::read_object_table() {
+    if (m_parsed)
+        return;
+
+    /*
+     * Objects and their arrays are allocated from an arena owned by this file and
+     * freed all at once. Every object shares ownership of the arena, so objects
+     * that are still referenced from elsewhere outlive the file safely. The arena
+     * grows as needed, so it starts small for files that are mostly raw data.
+     */
+    m_arena = std::make_shared<ash::arena>(std::clamp<std::size_t>(contents.size() / 2, 4096, 1024 * 1024));
+
+    /*
+     * Objects are found by hopping over their headers, so none of them
+     * is parsed yet. Anything that doesn't look like an object ends the
+     * table, e.g. in files that are not core files at all.
+     */
+    ash::buffer buffer(contents.data(), contents.size());
+
+    while (buffer.size() >= sizeof(CoreHeader) + sizeof(GUID)) {
+        const auto header = CoreObject::peek_header(buffer);
+        const auto size = sizeof(CoreHeader) + std::size_t(header.file_size);
+
+        if (header.file_size < sizeof(GUID) || size > buffer.size())
+            break;
+
+        auto guid_buffer = buffer.slice(sizeof(CoreHeader), sizeof(GUID));
+
+        CoreObjectInfo info { header.file_type, {}, static_cast<std::size_t>(buffer.data() - contents.data()), size };
+        info.guid.parse(guid_buffer, *this);
+
+        /* Objects with the same identifier are not expected, the first one wins */
+        if (m_object_indices.emplace(info.guid, m_object_table.size()).second)
+            manager.object_index->insert(info.guid, this, { entry.hash, std::uint32_t(m_object_table.size()) });
+
+        m_object_table.push_back(info);
+        buffer = buffer.skip(size);
+    }
+
+    if (buffer.size() > 0)
+        DECIMA_LOG("File ", uint64_to_hex(entry.hash), " has ", buffer.size(), " bytes that don't belong to any object");
+
+    m_objects.resize(m_object_table.size());
+    m_parsed = true;
+}
+
+bool Decima::CoreFile::parse_object(std::size_t index, const std::shared_ptr<ash::arena>& arena) {
+    if (m_objects[index] != nullptr)
+        return false;
+
+    const auto& info = m_object_table[index];
+    ash::buffer buffer(contents.data() + info.offset, info.size);
+
+    /*
+     * The object is stored before it's parsed, so references that were
+     * already queued by it stay valid even if the rest of it fails to parse.
+     */
+    auto& object = m_objects[index];
+
+    {
+        ash::arena_scope arena_scope(arena);
+        object = Decima::get_type_handler(info.type);
+    }
+
+    CurrentObjectScope object_scope(current_parsed_object, object);
+    ash::arena_scope arena_scope(arena);
+    object->parse(manager, buffer, *this);
+
+    return true;
+}
+
+bool Decima::CoreFile::parse_objects(const std::vector<std::size_t>& indices) {
+    const auto batch_size = std::max<std::size_t>(manager.parse_batch_size, 1);
+
+    if (manager.parallel_parse_threshold == 0 || indices.size() < manager.parallel_parse_threshold) {
+        bool parsed = false;
+
+        for (const auto index : indices)
+            parsed |= parse_object(index, m_arena);
+
+        return parsed;
+    }
+
+    /*
+     * Objects are independent of each other until their references are resolved,
+     * so they are parsed by workers in batches, each into its own slot of the table
+     * and its own arena, since arenas are not thread-safe. The file stays locked by
+     * this thread meanwhile. References queued by each object are collected apart
+     * and queued in order of objects afterwards, so the result is the same as if
+     * objects were parsed one after another.
+     */
+    std::vector<std::vector<Ref*>> object_references(indices.size());
+
+    const auto queue_object_references = [&] {
+        for (auto& references : object_references) {
+            for (auto* ref : references)
+                queue_reference(ref);
         }
+    };
+
+    try {
+        manager.workers->parallel_for(0, (indices.size() + batch_size - 1) / batch_size, [&](std::size_t batch) {
+            const auto batch_begin = batch * batch_size;
+            const auto batch_end = std::min(batch_begin + batch_size, indices.size());
+
+            std::size_t objects_size = 0;
+
+            for (auto task = batch_begin; task < batch_end; task++)
+                objects_size += m_object_table[indices[task]].size;
+
+            const auto arena = std::make_shared<ash::arena>(std::clamp<std::size_t>(objects_size / 2, 4096, 1024 * 1024));
+
+            try {
+                for (auto task = batch_begin; task < batch_end; task++) {
+                    DeferredReferencesScope references_scope(deferred_references, object_references[task]);
+                    parse_object(indices[task], arena);
+                }
+            } catch (...) {
+                m_batch_arenas_size += arena->size();
+                throw;
+            }
+
+            m_batch_arenas_size += arena->size();
+        });
+    } catch (...) {
+        queue_object_references();
+        throw;
+    }
+
+    queue_object_references();
+
+    return true;
+}
+
+bool Decima::CoreFile::resolve_references() {
+    bool parsed = false;
+
+    /* Targets are parsed on demand, and they may queue more references in turn */
+    while (!references.empty()) {
+        auto* ref = references.back();
+        references.pop_back();
+
+        const auto index = m_object_indices.find(ref->m_guid);
+
+        if (index == m_object_indices.end())
+            continue;
+
+        parsed |= parse_object(index->second, m_arena);
+        ref->m_object = m_objects[index->second];
+    }
+
+    return parsed;
+}
+
+void Decima::CoreFile::parse(const CoreObjectFilter& filter, bool wait) {
+    std::unique_lock lock(m_mutex);
+    bool parsed = false;
+
+    read_object_table();
+
+    if (filter) {
+        std::vector<std::size_t> indices;
+
+        for (std::size_t index = 0; index < m_object_table.size(); index++) {
+            if (m_objects[index] == nullptr && filter(m_object_table[index]))
+                indices.push_back(index);
+        }
+
+        parsed = parse_objects(indices);
+    }
+
+    finish_parse(lock, parsed, wait);
+}
+
+void Decima::CoreFile::finish_parse(std::unique_lock<std::mutex>& lock, bool parsed, bool wait) {
+    std::vector<Ref*> external_references;
+
+    /*
+     * References that are not resolved by now never will be,
+     * since all objects they could point to are known already.
+     */
+    parsed |= resolve_references();
+
+    /*
+     * References to other files are resolved by a single thread at a time,
+     * which keeps going until no more of them are queued. Callers from outside
+     * wait for it to finish, so all references of this file are resolved once
+     * parse returns. Files resolved in turn never wait, so threads resolving
+     * files that reference each other can't deadlock.
+     */
+    if (wait)
+        m_resolved.wait(lock, [this] { return !m_resolving; });
+
+    if (!m_resolving && !m_external_references.empty()) {
+        m_resolving = true;
+        external_references.swap(m_external_references);
+    }
+
+    lock.unlock();
+
+    while (!external_references.empty()) {
+        try {
+            resolve_external_references(external_references);
+        } catch (...) {
+            finish_resolving();
+            throw;
+        }
+
+        std::lock_guard lock(m_mutex);
+        external_references.clear();
+        external_references.swap(m_external_references);
+
+        if (external_references.empty()) {
+            m_resolving = false;
+            m_resolved.notify_all();
+        }
+    }
+
+    if (parsed)
+        manager.file_cache->update(entry.hash, *this);
+}
+
+void Decima::CoreFile::resolve_external_references(const std::vector<Ref*>& external_references) {
+    for (auto* ref : external_references) {
+        /*
+         * Targets in files that are in memory are found by their identifiers,
+         * and those that are parsed already are taken as is, without parsing
+         * the file again. Anything else goes through the file named by the reference.
+         */
+        const auto location = manager.object_index->find(ref->m_guid);
+        auto file = location ? manager.file_cache->find(location->file) : nullptr;
+        bool resolved = false;
+
+        if (file != nullptr) {
+            std::lock_guard lock(file->m_mutex);
+
+            if (location->object < file->m_objects.size() && file->m_object_table[location->object].guid == ref->m_guid && file->m_objects[location->object] != nullptr) {
+                ref->m_object = file->m_objects[location->object];
+                resolved = true;
+            }
+        }
+
+        if (!resolved) {
+            file = manager.query_file(ref->file().data());
+
+            if (file == nullptr)
+                continue;
+
+            {
+                std::lock_guard lock(file->m_mutex);
+                file->references.push_back(ref);
+            }
+
+            file->parse(nullptr, false);
+        }
+
+        if (ref->m_object != nullptr) {
+            std::lock_guard lock(m_dependencies_mutex);
+
+            if (std::find(m_dependencies.begin(), m_dependencies.end(), file->entry.hash) == m_dependencies.end())
+                m_dependencies.push_back(file->entry.hash);
+        }
+    }
+}
+
+void Decima::CoreFile::finish_resolving() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_resolving = false;
     }
 
-    resolve_reference(*this);
+    m_resolved.notify_all();
 }
@@ -1,24 +1,65 @@
 #include <optional>
+#include <stdexcept>
 
 #include "utils.hpp"
 #include "decima/archive/archive_manager.hpp"
 #include "decima/archive/archive.hpp"
 #include "decima/serializable/object/prefetch.hpp"
 
-void Decima::ArchiveManager::load_archive(const std::string& path) {
-    auto& archive = archives.emplace_back(path);
-    archive.open();
+void Decima::ArchiveManager::load_archive(const std::string& path, int priority) {
+    load_archives({ path }, priority);
+}
+
+void Decima::ArchiveManager::load_archives(const std::vector<std::string>& paths, int priority) {
+    std::vector<std::unique_ptr<Archive>> loaded_archives(paths.size());
+
+    workers->parallel_for(0, paths.size(), [&](std::size_t index) {
+        auto archive = std::make_unique<Archive>(paths[index]);
+
+        if (!archive->open(*workers))
+            return;
+
+        archive->priority = priority;
+        loaded_archives[index] = std::move(archive);
+    });
+
+    archives.reserve(archives.size() + loaded_archives.size());
+
+    for (std::size_t path_index = 0; path_index < paths.size(); path_index++) {
+        auto& loaded_archive = loaded_archives[path_index];
+
+        /* Archives that can't be read are skipped, so they're neither queried nor written into snapshots */
+        if (loaded_archive == nullptr) {
+            DECIMA_LOG("Archive '", paths[path_index], "' could not be opened and is skipped");
+            continue;
+        }
+
+        auto& archive = archives.emplace_back(std::move(*loaded_archive));
+
+        const auto archive_index = static_cast<std::uint32_t>(archives.size() - 1);
+        file_index.reserve(file_index.size() + archive.file_entries.size());
+
+        for (std::size_t index = 0; index < archive.file_entries.size(); index++) {
+            const auto hash = archive.file_entries[index].hash;
+            const auto [location, inserted] = file_index.insert(hash, archive_index, static_cast<std::uint32_t>(index));
 
-    for (const auto& entry : archive.file_entries) {
-        hash_to_archive_index.emplace(entry.hash, static_cast<int>(archives.size() - 1));
+            /* File that was already loaded from a lower layer may be cached, so it's dropped to not be served again */
+            if (!inserted && archives[location->archive].priority < priority) {
+                location->archive = archive_index;
+                location->entry = static_cast<std::uint32_t>(index);
+                file_cache->erase(hash);
+            }
+        }
     }
 }
 
 void Decima::ArchiveManager::load_prefetch() {
-    auto& prefetch_file = query_file("prefetch/fullgame.prefetch").value().get();
-    prefetch_file.parse();
+    auto prefetch_file = query_file("prefetch/fullgame.prefetch");
 
-    prefetch = std::make_unique<Prefetch>(static_cast<Prefetch&>(*prefetch_file.objects.at(0).first));
+    if (prefetch_file == nullptr)
+        throw std::runtime_error("Cannot find prefetch file 'prefetch/fullgame.prefetch' in loaded archives");
+
+    prefetch = std::make_unique<Prefetch>(static_cast<Prefetch&>(*prefetch_file->object(0)));
 
     for (std::uint64_t index = 0; index < prefetch->paths.data().size(); index++) {
         auto path = prefetch->paths.data()[index].data();
@@ -29,11 +70,8 @@ void Decima::ArchiveManager::load_prefetch() {
 }
 
 Decima::OptionalRef<Decima::ArchiveFileEntry> Decima::ArchiveManager::get_file_entry(std::uint64_t hash) {
-    if (auto archive_id = hash_to_archive_index.find(hash); archive_id != hash_to_archive_index.end()) {
-        auto& archive = archives.at(archive_id->second);
-        auto file_id = archive.m_hash_to_index.find(hash)->second;
-
-        return std::make_optional(std::ref(archive.file_entries.at(file_id)));
+    if (const auto location = file_index.find(hash)) {
+        return std::make_optional(std::ref(archives[location->archive].file_entries[location->entry]));
     }
 
     return {};
@@ -43,25 +81,50 @@ Decima::OptionalRef<Decima::ArchiveFileEntry> Decima::ArchiveManager::get_file_e
     return get_file_entry(hash_string(sanitize_name(name), cipher_seed));
 }
 
-Decima::OptionalRef<Decima::CoreFile> Decima::ArchiveManager::query_file(std::uint64_t hash) {
-    if (auto archive_index = hash_to_archive_index.find(hash); archive_index != hash_to_archive_index.end()) {
-        auto& archive = archives.at(archive_index->second);
+std::shared_ptr<Decima::CoreFile> Decima::ArchiveManager::query_file(std::uint64_t hash) {
+    if (auto file = file_cache->find(hash))
+        return file;
 
-        if (auto index = archive.m_hash_to_index.find(hash); index != archive.m_hash_to_index.end()) {
-            auto cache = archive.m_cache.find(index->second);
+    if (const auto location = file_index.find(hash)) {
+        auto& archive = archives[location->archive];
+        auto file = std::make_shared<Decima::CoreFile>(archive, *this, archive.file_entries[location->entry], archive.m_file);
 
-            if (cache == archive.m_cache.end()) {
-                Decima::CoreFile file(archive, *this, archive.file_entries.at(index->second), *archive.m_file);
-                cache = archive.m_cache.emplace(index->second, std::move(file)).first;
-            }
-
-            return std::make_optional(std::ref(cache->second));
-        }
+        /*
+         * The file is unpacked without holding the lock. If another thread
+         * got there first, its copy wins and this one is thrown away.
+         */
+        return file_cache->insert(hash, std::move(file));
     }
 
-    return {};
+    return nullptr;
 }
 
-Decima::OptionalRef<Decima::CoreFile> Decima::ArchiveManager::query_file(const std::string& name) {
+std::shared_ptr<Decima::CoreFile> Decima::ArchiveManager::query_file(const std::string& name) {
     return query_file(hash_string(sanitize_name(name), cipher_seed));
 }
+
+std::future<std::shared_ptr<Decima::CoreFile>> Decima::ArchiveManager::query_file_async(std::uint64_t hash, bool parse) {
+    return workers->submit([this, hash, parse] {
+        auto file = query_file(hash);
+
+        if (file != nullptr && parse)
+            file->parse();
+
+        return file;
+    });
+}
+
+std::future<std::shared_ptr<Decima::CoreFile>> Decima::ArchiveManager::query_file_async(const std::string& name, bool parse) {
+    return query_file_async(hash_string(sanitize_name(name), cipher_seed), parse);
+}
+
+std::vector<std::future<std::shared_ptr<Decima::CoreFile>>> Decima::ArchiveManager::query_files_async(const std::vector<std::uint64_t>& hashes, bool parse) {
+    std::vector<std::future<std::shared_ptr<Decima::CoreFile>>> files;
+    files.reserve(hashes.size());
+
+    for (const auto hash : hashes) {
+        files.push_back(query_file_async(hash, parse));
+    }
+
+    return files;
+}
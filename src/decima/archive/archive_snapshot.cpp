@@ -0,0 +1,224 @@
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#include "decima/archive/archive_manager.hpp"
+#include "utils.hpp"
+
+/*
+ * Snapshot is a flat sequence of plain values and arrays
+ * prefixed with their length, so it is read straight from
+ * the mapping with a buffer and written with a single stream.
+ */
+static constexpr std::uint32_t snapshot_magic = 0x50534E44; // DNSP
+static constexpr std::uint32_t snapshot_version = 2;
+
+struct ArchiveStamp {
+    std::uint64_t size;
+    std::int64_t time;
+};
+
+static ArchiveStamp get_archive_stamp(const std::string& path) {
+    return {
+        std::filesystem::file_size(path),
+        static_cast<std::int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count())
+    };
+}
+
+namespace {
+    class SnapshotWriter {
+    public:
+        explicit SnapshotWriter(const std::filesystem::path& path)
+            : m_stream(path, std::ios::binary) { }
+
+        template <typename T>
+        void write(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            m_stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template <typename T, typename Allocator>
+        void write(const std::vector<T, Allocator>& values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            write(static_cast<std::uint64_t>(values.size()));
+            m_stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+
+        void write(const std::string& value) {
+            write(static_cast<std::uint32_t>(value.size()));
+            m_stream.write(value.data(), value.size());
+        }
+
+        bool good() const { return m_stream.good(); }
+        void close() { m_stream.close(); }
+
+    private:
+        std::ofstream m_stream;
+    };
+
+    class SnapshotReader {
+    public:
+        explicit SnapshotReader(const ash::buffer& buffer)
+            : m_buffer(buffer) { }
+
+        template <typename T>
+        T read() {
+            return m_buffer.get<T>();
+        }
+
+        template <typename T, typename Allocator>
+        void read(std::vector<T, Allocator>& values) {
+            values.resize(m_buffer.get<std::uint64_t>());
+
+            if (!values.empty())
+                m_buffer.get(values);
+        }
+
+        std::string read_string() {
+            std::string value(m_buffer.get<std::uint32_t>(), '\0');
+            m_buffer.get(value);
+            return value;
+        }
+
+    private:
+        ash::buffer m_buffer;
+    };
+}
+
+bool Decima::ArchiveManager::load_snapshot(const std::string& path, const std::vector<std::string>& archive_paths) {
+    /*
+     * Cached files and chunks refer to entries of loaded archives,
+     * which replacing the tables would leave dangling, so snapshots
+     * can only be loaded into a manager that has nothing loaded yet.
+     */
+    if (!archives.empty() || prefetch != nullptr)
+        throw std::runtime_error("Snapshot '" + path + "' cannot be loaded after archives were loaded");
+
+    if (!std::filesystem::exists(path))
+        return false;
+
+    try {
+        ash::mapped_file snapshot(path);
+        SnapshotReader reader(snapshot.view());
+
+        if (reader.read<std::uint32_t>() != snapshot_magic || reader.read<std::uint32_t>() != snapshot_version)
+            return false;
+
+        if (reader.read<std::uint64_t>() != archive_paths.size())
+            return false;
+
+        std::vector<Archive> loaded_archives;
+        loaded_archives.reserve(archive_paths.size());
+
+        for (const auto& archive_path : archive_paths) {
+            const auto expected_stamp = get_archive_stamp(archive_path);
+            const auto stamp = reader.read<ArchiveStamp>();
+
+            if (reader.read_string() != archive_path || stamp.size != expected_stamp.size || stamp.time != expected_stamp.time)
+                return false;
+
+            auto& archive = loaded_archives.emplace_back(archive_path);
+            archive.priority = reader.read<std::int32_t>();
+            archive.header = reader.read<ArchiveHeader>();
+            reader.read(archive.file_entries);
+            reader.read(archive.chunk_entries);
+            reader.read(archive.chunk_keys);
+            reader.read(archive.m_chunk_index);
+        }
+
+        FileIndex loaded_file_index;
+        reader.read(loaded_file_index.m_slots);
+        loaded_file_index.m_mask = loaded_file_index.m_slots.empty() ? 0 : loaded_file_index.m_slots.size() - 1;
+        loaded_file_index.m_size = reader.read<std::uint64_t>();
+
+        auto loaded_prefetch = std::make_unique<Prefetch>();
+        loaded_prefetch->header = reader.read<CoreHeader>();
+        loaded_prefetch->guid = reader.read<GUID>();
+
+        std::vector<std::uint64_t> path_hashes;
+        reader.read(path_hashes);
+
+        for (std::size_t index = 0; index < path_hashes.size(); index++) {
+            const auto hash = reader.read<std::uint32_t>();
+            loaded_prefetch->paths.data().emplace_back(reader.read_string(), hash);
+        }
+
+        reader.read(loaded_prefetch->sizes.data());
+        loaded_prefetch->links_total = reader.read<std::uint32_t>();
+        loaded_prefetch->links.resize(path_hashes.size());
+
+        for (auto& link : loaded_prefetch->links)
+            reader.read(link.data());
+
+        archives = std::move(loaded_archives);
+        file_index = std::move(loaded_file_index);
+        prefetch = std::move(loaded_prefetch);
+
+        for (std::size_t index = 0; index < path_hashes.size(); index++) {
+            hash_to_name.emplace(path_hashes[index], prefetch->paths.data()[index].data());
+            hash_to_index.emplace(path_hashes[index], index);
+        }
+    } catch (const std::exception& e) {
+        DECIMA_LOG("Snapshot '", path, "' could not be loaded: ", e.what());
+        return false;
+    }
+
+    return true;
+}
+
+void Decima::ArchiveManager::save_snapshot(const std::string& path) const {
+    /*
+     * Snapshot is written next to its final location and moved
+     * into place once complete, so a crash halfway through never
+     * leaves a truncated snapshot behind.
+     */
+    const auto temporary_path = std::filesystem::path(path + ".tmp");
+
+    SnapshotWriter writer(temporary_path);
+    writer.write(snapshot_magic);
+    writer.write(snapshot_version);
+    writer.write(static_cast<std::uint64_t>(archives.size()));
+
+    for (const auto& archive : archives) {
+        writer.write(get_archive_stamp(archive.path));
+        writer.write(archive.path);
+        writer.write(static_cast<std::int32_t>(archive.priority));
+        writer.write(archive.header);
+        writer.write(archive.file_entries);
+        writer.write(archive.chunk_entries);
+        writer.write(archive.chunk_keys);
+        writer.write(archive.m_chunk_index);
+    }
+
+    writer.write(file_index.m_slots);
+    writer.write(static_cast<std::uint64_t>(file_index.m_size));
+
+    const auto& paths = prefetch->paths.data();
+    std::vector<std::uint64_t> path_hashes;
+    path_hashes.reserve(paths.size());
+
+    for (const auto& prefetch_path : paths)
+        path_hashes.push_back(hash_string(sanitize_name(prefetch_path.data()), cipher_seed));
+
+    writer.write(prefetch->header);
+    writer.write(prefetch->guid);
+    writer.write(path_hashes);
+
+    for (const auto& prefetch_path : paths) {
+        writer.write(prefetch_path.hash());
+        writer.write(prefetch_path.data());
+    }
+
+    writer.write(prefetch->sizes.data());
+    writer.write(prefetch->links_total);
+
+    for (const auto& link : prefetch->links)
+        writer.write(link.data());
+
+    writer.close();
+
+    if (!writer.good())
+        throw std::runtime_error("Cannot write snapshot '" + path + "'");
+
+    std::filesystem::rename(temporary_path, path);
+}
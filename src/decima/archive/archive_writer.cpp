@@ -0,0 +1,201 @@
+#include "decima/archive/archive_writer.hpp"
+#include "decima/archive/archive_manager.hpp"
+#include "decima/shared.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+Decima::ArchiveWriter::ArchiveWriter(const Compressor& compressor, CompressionLevel level, ArchiveType type)
+    : m_compressor(compressor)
+    , m_level(level)
+    , m_type(type) { }
+
+void Decima::ArchiveWriter::add_file(const std::string& name, ash::shared_buffer contents) {
+    add_file(hash_string(sanitize_name(name), cipher_seed), std::move(contents));
+}
+
+void Decima::ArchiveWriter::add_file(std::uint64_t hash, ash::shared_buffer contents) {
+    m_files.push_back({ hash, std::move(contents) });
+}
+
+std::size_t Decima::ArchiveWriter::remove_unchanged(ArchiveManager& base) {
+    std::unordered_map<std::uint64_t, std::size_t> file_indices;
+    std::vector<std::uint64_t> hashes;
+    hashes.reserve(m_files.size());
+
+    for (std::size_t index = 0; index < m_files.size(); index++) {
+        if (file_indices.emplace(m_files[index].hash, index).second)
+            hashes.push_back(m_files[index].hash);
+    }
+
+    /* Every file is reported exactly once, so each flag is written by a single thread */
+    std::vector<char> unchanged(m_files.size(), false);
+
+    base.extract_files(hashes, [&](std::uint64_t hash, const ash::shared_buffer& contents) {
+        const auto index = file_indices.at(hash);
+        const auto& file = m_files[index].contents;
+        unchanged[index] = file.size() == contents.size() && std::equal(file.begin(), file.end(), contents.begin());
+    });
+
+    std::size_t kept = 0;
+
+    for (std::size_t index = 0; index < m_files.size(); index++) {
+        if (!unchanged[index])
+            m_files[kept++] = std::move(m_files[index]);
+    }
+
+    const auto removed = m_files.size() - kept;
+    m_files.resize(kept);
+
+    return removed;
+}
+
+void Decima::ArchiveWriter::write(const std::string& path, ash::thread_pool& workers) const {
+    if (chunk_maximum_size == 0)
+        throw std::runtime_error("Chunk size of archive must not be zero");
+
+    /*
+     * Keys only need to differ between entries, so they are generated
+     * from a fixed seed to make writing the same files reproducible.
+     */
+    std::mt19937 random_keys(0x44534150);
+
+    std::vector<ArchiveFileEntry> file_entries;
+    file_entries.reserve(m_files.size());
+
+    std::uint64_t data_size = 0;
+
+    for (const auto& file : m_files) {
+        ArchiveFileEntry entry {};
+        entry.index = static_cast<std::uint32_t>(file_entries.size());
+        entry.key = random_keys();
+        entry.hash = file.hash;
+        entry.span.offset = data_size;
+        entry.span.size = static_cast<std::uint32_t>(file.contents.size());
+        entry.span.key = random_keys();
+
+        if (entry.span.size != file.contents.size())
+            throw std::runtime_error("File " + uint64_to_hex(file.hash) + " is too large to be stored in an archive");
+
+        file_entries.push_back(entry);
+        data_size += file.contents.size();
+    }
+
+    std::sort(file_entries.begin(), file_entries.end(), [](const auto& a, const auto& b) { return a.hash < b.hash; });
+
+    const auto duplicate = std::adjacent_find(file_entries.begin(), file_entries.end(), [](const auto& a, const auto& b) { return a.hash == b.hash; });
+
+    if (duplicate != file_entries.end())
+        throw std::runtime_error("File " + uint64_to_hex(duplicate->hash) + " was added to the archive more than once");
+
+    std::vector<ArchiveChunkEntry> chunk_entries((data_size + chunk_maximum_size - 1) / chunk_maximum_size);
+
+    for (std::size_t index = 0; index < chunk_entries.size(); index++) {
+        auto& span = chunk_entries[index].decompressed_span;
+        span.offset = index * std::uint64_t(chunk_maximum_size);
+        span.size = static_cast<std::uint32_t>(std::min<std::uint64_t>(chunk_maximum_size, data_size - span.offset));
+        span.key = random_keys();
+        chunk_entries[index].compressed_span.key = random_keys();
+    }
+
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+
+    if (!output)
+        throw std::runtime_error("Cannot open archive '" + path + "' for writing");
+
+    /* Tables are only known once all chunks are compressed, so they're written last */
+    const std::uint64_t tables_size = sizeof(ArchiveHeader) + file_entries.size() * sizeof(ArchiveFileEntry) + chunk_entries.size() * sizeof(ArchiveChunkEntry);
+    const std::vector<char> placeholder(tables_size);
+    output.write(placeholder.data(), placeholder.size());
+
+    const auto window_size = std::max<std::size_t>(1, workers.size() * chunks_per_worker);
+    const auto compressed_bound = m_compressor.compression_bound(chunk_maximum_size);
+
+    std::vector<char> decompressed(std::min<std::size_t>(window_size, chunk_entries.size()) * chunk_maximum_size);
+    std::vector<char> compressed(std::min<std::size_t>(window_size, chunk_entries.size()) * compressed_bound);
+    std::vector<std::uint32_t> compressed_sizes(window_size);
+
+    std::size_t file_index = 0;
+    std::size_t file_offset = 0;
+    std::uint64_t archive_offset = tables_size;
+
+    for (std::size_t window_begin = 0; window_begin < chunk_entries.size(); window_begin += window_size) {
+        const auto window_end = std::min(chunk_entries.size(), window_begin + window_size);
+
+        /* Contents of files are concatenated, so a single chunk may span several of them */
+        for (auto index = window_begin; index < window_end; index++) {
+            auto chunk_data = decompressed.data() + (index - window_begin) * chunk_maximum_size;
+            std::size_t remaining = chunk_entries[index].decompressed_span.size;
+
+            while (remaining > 0) {
+                const auto& contents = m_files[file_index].contents;
+                const auto count = std::min(remaining, contents.size() - file_offset);
+
+                std::memcpy(chunk_data, contents.data() + file_offset, count);
+                chunk_data += count;
+                file_offset += count;
+                remaining -= count;
+
+                if (file_offset == contents.size()) {
+                    file_index++;
+                    file_offset = 0;
+                }
+            }
+        }
+
+        workers.parallel_for(window_begin, window_end, [&](std::size_t index) {
+            const auto& chunk = chunk_entries[index];
+            const auto src = decompressed.data() + (index - window_begin) * chunk_maximum_size;
+            const auto dst = compressed.data() + (index - window_begin) * compressed_bound;
+            const auto size = m_compressor.compress(src, chunk.decompressed_span.size, dst, m_level);
+
+            if (size == 0 || size > compressed_bound)
+                throw std::runtime_error("Cannot compress chunk at offset " + std::to_string(chunk.decompressed_span.offset) + " of archive '" + path + "'");
+
+            /* The cipher is a plain XOR, so encrypting is the same as decrypting */
+            if (m_type == ArchiveType::Encrypted)
+                decrypt_chunk(dst, dst, size, derive_chunk_key(chunk));
+
+            compressed_sizes[index - window_begin] = size;
+        });
+
+        for (auto index = window_begin; index < window_end; index++) {
+            auto& span = chunk_entries[index].compressed_span;
+            span.offset = archive_offset;
+            span.size = compressed_sizes[index - window_begin];
+
+            output.write(compressed.data() + (index - window_begin) * compressed_bound, span.size);
+            archive_offset += span.size;
+        }
+    }
+
+    ArchiveHeader header {};
+    header.type = m_type;
+    header.key = random_keys();
+    header.file_size = archive_offset;
+    header.data_size = data_size;
+    header.file_entries_count = file_entries.size();
+    header.chunk_entries_count = static_cast<std::uint32_t>(chunk_entries.size());
+    header.chunk_maximum_size = chunk_maximum_size;
+
+    if (m_type == ArchiveType::Encrypted) {
+        decrypt_block(&header.file_size, header.key, header.key + 1);
+        decrypt_table(file_entries.data(), file_entries.size(), offsetof(ArchiveFileEntry, key), offsetof(ArchiveFileEntry, span) + offsetof(ArchiveSpan, key));
+        decrypt_table(chunk_entries.data(), chunk_entries.size(), offsetof(ArchiveChunkEntry, decompressed_span) + offsetof(ArchiveSpan, key), offsetof(ArchiveChunkEntry, compressed_span) + offsetof(ArchiveSpan, key));
+    }
+
+    output.seekp(0);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(file_entries.data()), file_entries.size() * sizeof(ArchiveFileEntry));
+    output.write(reinterpret_cast<const char*>(chunk_entries.data()), chunk_entries.size() * sizeof(ArchiveChunkEntry));
+    output.flush();
+
+    if (!output)
+        throw std::runtime_error("Cannot write archive '" + path + "'");
+}
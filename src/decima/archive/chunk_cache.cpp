@@ -0,0 +1,64 @@
+#include "decima/archive/chunk_cache.hpp"
+
+Decima::ChunkCache::ChunkCache(std::size_t budget)
+    : m_budget(budget) { }
+
+Decima::ChunkCache::Chunk Decima::ChunkCache::find(const ArchiveChunkEntry& chunk) {
+    std::lock_guard lock(m_mutex);
+
+    if (auto entry = m_lookup.find(&chunk); entry != m_lookup.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, entry->second);
+        m_hits++;
+        return entry->second->second;
+    }
+
+    m_misses++;
+    return {};
+}
+
+void Decima::ChunkCache::insert(const ArchiveChunkEntry& chunk, Chunk data) {
+    std::lock_guard lock(m_mutex);
+
+    if (data.size() > m_budget || m_lookup.find(&chunk) != m_lookup.end())
+        return;
+
+    m_size += data.size();
+    m_entries.emplace_front(&chunk, std::move(data));
+    m_lookup.emplace(&chunk, m_entries.begin());
+
+    evict();
+}
+
+void Decima::ChunkCache::clear() {
+    std::lock_guard lock(m_mutex);
+
+    m_entries.clear();
+    m_lookup.clear();
+    m_size = 0;
+}
+
+void Decima::ChunkCache::set_budget(std::size_t budget) {
+    std::lock_guard lock(m_mutex);
+
+    m_budget = budget;
+    evict();
+}
+
+std::size_t Decima::ChunkCache::budget() const {
+    std::lock_guard lock(m_mutex);
+    return m_budget;
+}
+
+std::size_t Decima::ChunkCache::size() const {
+    std::lock_guard lock(m_mutex);
+    return m_size;
+}
+
+void Decima::ChunkCache::evict() {
+    while (m_size > m_budget) {
+        const auto& [chunk, data] = m_entries.back();
+        m_size -= data.size();
+        m_lookup.erase(chunk);
+        m_entries.pop_back();
+    }
+}
@@ -0,0 +1,247 @@
+#include "decima/archive/file_cache.hpp"
+#include "decima/archive/archive_file.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+
+Decima::FileCache::FileCache(std::size_t budget)
+    : m_budget(budget) { }
+
+std::shared_ptr<Decima::CoreFile> Decima::FileCache::find(std::uint64_t hash) {
+    auto& shard = shard_of(hash);
+    std::lock_guard lock(shard.mutex);
+
+    if (auto entry = shard.entries.find(hash); entry != shard.entries.end()) {
+        shard.order.splice(shard.order.begin(), shard.order, entry->second.position);
+        return entry->second.file;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<Decima::CoreFile> Decima::FileCache::insert(std::uint64_t hash, std::shared_ptr<CoreFile> file) {
+    /* Files are measured before the shard is locked, since that locks the file itself */
+    const auto size = file->memory_usage();
+    auto dependencies = file->dependencies();
+    dependencies.erase(std::remove(dependencies.begin(), dependencies.end(), hash), dependencies.end());
+
+    /* Dependencies are counted before the file can be found, so they are never released before that */
+    retain(dependencies);
+
+    std::vector<std::shared_ptr<CoreFile>> evicted;
+    std::shared_ptr<CoreFile> existing;
+
+    {
+        auto& shard = shard_of(hash);
+        std::lock_guard lock(shard.mutex);
+
+        if (auto entry = shard.entries.find(hash); entry != shard.entries.end()) {
+            existing = entry->second.file;
+        } else {
+            shard.order.push_front(hash);
+            shard.entries.emplace(hash, Entry { file, shard.order.begin(), size, dependencies });
+            m_size += size;
+        }
+    }
+
+    if (existing != nullptr) {
+        release(dependencies);
+        return existing;
+    }
+
+    evict(evicted);
+
+    return file;
+}
+
+void Decima::FileCache::update(std::uint64_t hash, const CoreFile& file) {
+    const auto size = file.memory_usage();
+    auto dependencies = file.dependencies();
+    dependencies.erase(std::remove(dependencies.begin(), dependencies.end(), hash), dependencies.end());
+
+    retain(dependencies);
+
+    std::vector<std::shared_ptr<CoreFile>> evicted;
+    std::vector<std::uint64_t> released;
+
+    {
+        auto& shard = shard_of(hash);
+        std::lock_guard lock(shard.mutex);
+
+        /* The file may have been evicted or replaced by a file from another archive since then */
+        if (auto entry = shard.entries.find(hash); entry != shard.entries.end() && entry->second.file.get() == &file) {
+            released = std::exchange(entry->second.dependencies, std::move(dependencies));
+            m_size += size;
+            m_size -= entry->second.size;
+            entry->second.size = size;
+        } else {
+            released = std::move(dependencies);
+        }
+    }
+
+    release(released);
+    evict(evicted);
+}
+
+void Decima::FileCache::erase(std::uint64_t hash) {
+    std::vector<std::shared_ptr<CoreFile>> erased;
+    std::vector<std::uint64_t> released;
+
+    {
+        auto& shard = shard_of(hash);
+        std::lock_guard lock(shard.mutex);
+
+        if (auto entry = shard.entries.find(hash); entry != shard.entries.end())
+            remove(shard, entry, erased, released);
+    }
+
+    release(released);
+}
+
+void Decima::FileCache::set_budget(std::size_t budget) {
+    std::vector<std::shared_ptr<CoreFile>> evicted;
+
+    m_budget = budget;
+    m_blocked_size = 0;
+    evict(evicted);
+}
+
+std::size_t Decima::FileCache::budget() const {
+    return m_budget;
+}
+
+std::size_t Decima::FileCache::size() const {
+    return m_size;
+}
+
+void Decima::FileCache::evict(std::vector<std::shared_ptr<CoreFile>>& evicted) {
+    if (m_size <= m_budget || m_size < m_blocked_size)
+        return;
+
+    const auto first_shard = m_next_shard++;
+
+    for (std::size_t index = 0; index < shard_count && m_size > m_budget; index++) {
+        auto& shard = m_shards[(first_shard + index) % shard_count];
+        std::vector<std::uint64_t> released;
+
+        {
+            std::lock_guard lock(shard.mutex);
+
+            /*
+             * Files that can't be evicted yet are moved to the front, so each
+             * file is looked at once at most. Handles are only ever copied out
+             * of the shard under its lock, so the use count can't grow behind
+             * our back. Dependencies released by evicted files are moved to the
+             * back of their shards, so they are evicted next.
+             */
+            for (std::size_t skipped = 0; m_size > m_budget && skipped < shard.entries.size();) {
+                const auto entry = shard.entries.find(shard.order.back());
+
+                if (entry->second.file.use_count() > 1 || shard.dependents.find(entry->first) != shard.dependents.end()) {
+                    shard.order.splice(shard.order.begin(), shard.order, entry->second.position);
+                    skipped++;
+                } else {
+                    remove(shard, entry, evicted, released);
+                }
+            }
+        }
+
+        release(released);
+    }
+
+    if (m_size > m_budget)
+        collect(evicted);
+
+    /*
+     * If everything left is in use, looking through the whole cache again
+     * on every insertion would be wasted, so the next attempt is made once
+     * the cache has grown by another sixteenth of the budget.
+     */
+    m_blocked_size = m_size > m_budget ? m_size + m_budget / 16 : 0;
+}
+
+void Decima::FileCache::collect(std::vector<std::shared_ptr<CoreFile>>& evicted) {
+    /* Shards are always locked in the same order, so two threads collecting at once can't deadlock */
+    std::array<std::unique_lock<std::mutex>, shard_count> locks;
+
+    for (std::size_t index = 0; index < shard_count; index++)
+        locks[index] = std::unique_lock(m_shards[index].mutex);
+
+    std::unordered_set<std::uint64_t> alive;
+    std::vector<std::uint64_t> pending;
+
+    for (const auto& shard : m_shards) {
+        for (const auto& [hash, entry] : shard.entries) {
+            if (entry.file.use_count() > 1)
+                pending.push_back(hash);
+        }
+    }
+
+    while (!pending.empty()) {
+        const auto hash = pending.back();
+        pending.pop_back();
+
+        auto& shard = shard_of(hash);
+
+        if (const auto entry = shard.entries.find(hash); entry != shard.entries.end() && alive.insert(hash).second)
+            pending.insert(pending.end(), entry->second.dependencies.begin(), entry->second.dependencies.end());
+    }
+
+    std::vector<std::uint64_t> unreachable;
+
+    for (const auto& shard : m_shards) {
+        for (auto position = shard.order.rbegin(); position != shard.order.rend(); ++position) {
+            if (alive.find(*position) == alive.end())
+                unreachable.push_back(*position);
+        }
+    }
+
+    std::vector<std::uint64_t> released;
+
+    for (std::size_t index = 0; index < unreachable.size() && m_size > m_budget; index++) {
+        auto& shard = shard_of(unreachable[index]);
+        remove(shard, shard.entries.find(unreachable[index]), evicted, released);
+
+        for (const auto hash : released)
+            release(shard_of(hash), hash);
+
+        released.clear();
+    }
+}
+
+void Decima::FileCache::remove(Shard& shard, EntryIterator entry, std::vector<std::shared_ptr<CoreFile>>& evicted, std::vector<std::uint64_t>& released) {
+    m_size -= entry->second.size;
+    shard.order.erase(entry->second.position);
+    evicted.push_back(std::move(entry->second.file));
+    released.insert(released.end(), entry->second.dependencies.begin(), entry->second.dependencies.end());
+    shard.entries.erase(entry);
+}
+
+void Decima::FileCache::release(Shard& shard, std::uint64_t hash) {
+    const auto dependents = shard.dependents.find(hash);
+
+    if (--dependents->second > 0)
+        return;
+
+    shard.dependents.erase(dependents);
+
+    if (const auto entry = shard.entries.find(hash); entry != shard.entries.end())
+        shard.order.splice(shard.order.end(), shard.order, entry->second.position);
+}
+
+void Decima::FileCache::retain(const std::vector<std::uint64_t>& dependencies) {
+    for (const auto hash : dependencies) {
+        auto& shard = shard_of(hash);
+        std::lock_guard lock(shard.mutex);
+        shard.dependents[hash]++;
+    }
+}
+
+void Decima::FileCache::release(const std::vector<std::uint64_t>& dependencies) {
+    for (const auto hash : dependencies) {
+        auto& shard = shard_of(hash);
+        std::lock_guard lock(shard.mutex);
+        release(shard, hash);
+    }
+}
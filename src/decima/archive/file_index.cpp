@@ -0,0 +1,53 @@
+#include "decima/archive/file_index.hpp"
+
+#include <utility>
+
+/* Table is kept at most 70% full to keep probe sequences short */
+static std::size_t capacity_for(std::size_t count) {
+    std::size_t capacity = 16;
+
+    while (capacity * 7 / 10 < count)
+        capacity *= 2;
+
+    return capacity;
+}
+
+void Decima::FileIndex::reserve(std::size_t count) {
+    if (const auto capacity = capacity_for(count); capacity > m_slots.size())
+        rehash(capacity);
+}
+
+std::pair<Decima::FileIndex::Location*, bool> Decima::FileIndex::insert(std::uint64_t hash, std::uint32_t archive, std::uint32_t entry) {
+    reserve(m_size + 1);
+
+    for (auto index = hash & m_mask;; index = (index + 1) & m_mask) {
+        auto& slot = m_slots[index];
+
+        if (slot.archive == empty_slot) {
+            slot = { hash, archive, entry };
+            m_size++;
+            return { &slot, true };
+        }
+
+        if (slot.hash == hash)
+            return { &slot, false };
+    }
+}
+
+void Decima::FileIndex::rehash(std::size_t capacity) {
+    std::vector<Location> slots(capacity, Location { 0, empty_slot, 0 });
+    std::swap(m_slots, slots);
+    m_mask = capacity - 1;
+
+    for (const auto& slot : slots) {
+        if (slot.archive == empty_slot)
+            continue;
+
+        for (auto index = slot.hash & m_mask;; index = (index + 1) & m_mask) {
+            if (m_slots[index].archive == empty_slot) {
+                m_slots[index] = slot;
+                break;
+            }
+        }
+    }
+}
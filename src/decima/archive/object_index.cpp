@@ -0,0 +1,127 @@
+#include "decima/archive/object_index.hpp"
+
+#include <utility>
+
+/* Shards are kept at most 70% full to keep probe sequences short */
+static std::size_t capacity_for(std::size_t count) {
+    std::size_t capacity = 16;
+
+    while (capacity * 7 / 10 < count)
+        capacity *= 2;
+
+    return capacity;
+}
+
+void Decima::ObjectIndex::insert(const GUID& guid, const CoreFile* owner, Location location) {
+    auto& shard = m_shards[shard_of(guid)];
+    std::lock_guard lock(shard.mutex);
+
+    if (const auto capacity = capacity_for(shard.size + 1); capacity > shard.slots.size())
+        rehash(shard, capacity);
+
+    for (auto index = slot_of(guid) & shard.mask;; index = (index + 1) & shard.mask) {
+        auto& slot = shard.slots[index];
+
+        if (slot.owner == nullptr) {
+            slot = { guid, owner, location };
+            shard.size++;
+            return;
+        }
+
+        if (slot.guid == guid) {
+            slot.owner = owner;
+            slot.location = location;
+            return;
+        }
+    }
+}
+
+void Decima::ObjectIndex::erase(const GUID& guid, const CoreFile* owner) {
+    auto& shard = m_shards[shard_of(guid)];
+    std::lock_guard lock(shard.mutex);
+
+    if (shard.slots.empty())
+        return;
+
+    auto index = slot_of(guid) & shard.mask;
+
+    for (;; index = (index + 1) & shard.mask) {
+        const auto& slot = shard.slots[index];
+
+        if (slot.owner == nullptr)
+            return;
+
+        if (slot.guid == guid)
+            break;
+    }
+
+    if (shard.slots[index].owner != owner)
+        return;
+
+    /*
+     * Slots that follow the erased one are shifted back into the gap when their
+     * probe sequence passes through it, so no tombstones are ever left behind.
+     */
+    for (auto next = (index + 1) & shard.mask; shard.slots[next].owner != nullptr; next = (next + 1) & shard.mask) {
+        const auto home = slot_of(shard.slots[next].guid) & shard.mask;
+
+        if (((next - home) & shard.mask) >= ((next - index) & shard.mask)) {
+            shard.slots[index] = shard.slots[next];
+            index = next;
+        }
+    }
+
+    shard.slots[index].owner = nullptr;
+    shard.size--;
+
+    /* Shards shrink along with evicted files, leaving some room to grow back */
+    if (const auto capacity = capacity_for(shard.size) * 2; capacity * 2 <= shard.slots.size())
+        rehash(shard, capacity);
+}
+
+std::optional<Decima::ObjectIndex::Location> Decima::ObjectIndex::find(const GUID& guid) const {
+    const auto& shard = m_shards[shard_of(guid)];
+    std::lock_guard lock(shard.mutex);
+
+    if (shard.slots.empty())
+        return std::nullopt;
+
+    for (auto index = slot_of(guid) & shard.mask;; index = (index + 1) & shard.mask) {
+        const auto& slot = shard.slots[index];
+
+        if (slot.owner == nullptr)
+            return std::nullopt;
+
+        if (slot.guid == guid)
+            return slot.location;
+    }
+}
+
+std::size_t Decima::ObjectIndex::size() const {
+    std::size_t size = 0;
+
+    for (const auto& shard : m_shards) {
+        std::lock_guard lock(shard.mutex);
+        size += shard.size;
+    }
+
+    return size;
+}
+
+void Decima::ObjectIndex::rehash(Shard& shard, std::size_t capacity) {
+    std::vector<Slot> slots(capacity, Slot { {}, nullptr, {} });
+    std::swap(shard.slots, slots);
+    shard.mask = capacity - 1;
+
+    for (const auto& slot : slots) {
+        if (slot.owner == nullptr)
+            continue;
+
+        for (auto index = slot_of(slot.guid) & shard.mask;; index = (index + 1) & shard.mask) {
+            if (shard.slots[index].owner == nullptr) {
+                shard.slots[index] = slot;
+                break;
+            }
+        }
+    }
+}
@@ -11,6 +11,7 @@
 #include "decima/serializable/object/resource/index_array_resource.hpp"
 #include "decima/serializable/object/resource/primitive_resource.hpp"
 
+#include "util/arena.hpp"
 #include "utils.hpp"
 
 class FileMagics {
@@ -37,8 +38,11 @@ public:
     static constexpr uint64_t Texture = 0xf2e1afb7052b3866;
 };
 
+/* Objects of a file being parsed are placed into its arena along with their reference counts */
 template <class T, typename... Args>
 inline static std::shared_ptr<Decima::CoreObject> construct(Args&&... args) {
+    if (const auto& arena = ash::arena::current())
+        return std::allocate_shared<T>(ash::arena_allocator<T>(arena), std::forward<Args>(args)...);
     return std::make_shared<T>(std::forward<Args>(args)...);
 }
 
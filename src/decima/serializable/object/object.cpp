@@ -5,4 +5,6 @@ namespace Decima {
         header = buffer.get<decltype(header)>();
         guid.parse(buffer, file);
     }
+
+    void CoreObject::request_external_data() { }
 }
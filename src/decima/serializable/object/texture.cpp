@@ -73,13 +73,58 @@ void Decima::Texture::parse(ArchiveManager& manager, ash::buffer& buffer, CoreFi
      */
 
     buffer.get(embedded_data.data(), std::min(embedded_data.size(), buffer.size()));
+}
+
+void Decima::TextureReleaseQueue::push(const std::vector<unsigned int>& textures) {
+    std::lock_guard lock(m_mutex);
+    m_textures.insert(m_textures.end(), textures.begin(), textures.end());
+}
+
+void Decima::TextureReleaseQueue::release() {
+    std::vector<unsigned int> textures;
+
+    {
+        std::lock_guard lock(m_mutex);
+        textures.swap(m_textures);
+    }
+
+    if (!textures.empty())
+        glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+}
+
+/* Only accessed on the render thread */
+static std::shared_ptr<Decima::TextureReleaseQueue> current_release_queue;
+
+void Decima::Texture::set_release_queue(std::shared_ptr<TextureReleaseQueue> queue) {
+    current_release_queue = std::move(queue);
+}
+
+void Decima::Texture::request_external_data() {
+    if (stream_size > 0)
+        external_data.data_async();
+}
+
+void Decima::Texture::create_textures() {
+    textures_created = true;
+    release_queue = current_release_queue;
+
+    ash::shared_buffer stream;
+
+    if (stream_size > 0) {
+        try {
+            stream = external_data.data_async().get();
+        } catch (const std::exception& e) {
+            DECIMA_LOG("Failed to read stream of texture: ", e.what());
+        }
+    }
 
     if (const auto format = texture_format_info.find(pixel_format); format != texture_format_info.end()) {
         const auto [format_block_size, format_block_density, format_type_internal, format_type_data, format_compressed] = format->second;
 
-        const char* stream_data = nullptr;
+        const char* mip_data = stream.data();
+        std::size_t mip_data_size = stream.size();
 
-        for (auto mip = 0; mip < total_mips; mip++) {
+        for (std::uint32_t mip = 0; mip < total_mips; mip++) {
             /*
              * Mips that are smaller than minimum block size
              * actually occupy size of one block and must be
@@ -88,22 +133,29 @@ void Decima::Texture::parse(ArchiveManager& manager, ash::buffer& buffer, CoreFi
              */
             const auto mip_width = std::max(width >> mip, format_block_size);
             const auto mip_height = std::max(height >> mip, format_block_size);
-            const auto mip_buffer_size = mip_width * mip_height * format_block_density / 8;
-
-            if (mip == 0)
-                stream_data = external_data.data().data();
-
-            if (mip >= stream_mips)
-                stream_data = embedded_data.data();
-
-            mip_textures.push_back(format->second.create_texture(mip_width, mip_height, stream_data, mip_buffer_size));
-            stream_data += mip_buffer_size;
+            const auto mip_buffer_size = static_cast<std::size_t>(mip_width * mip_height * format_block_density / 8);
+
+            if (mip == stream_mips) {
+                mip_data = embedded_data.data();
+                mip_data_size = embedded_data.size();
+            }
+
+            /* Mips whose data is missing, e.g. because the stream couldn't be read, are left empty */
+            if (mip_data == nullptr || mip_buffer_size > mip_data_size) {
+                mip_textures.push_back(0);
+                mip_data_size = 0;
+                continue;
+            }
+
+            mip_textures.push_back(format->second.create_texture(mip_width, mip_height, mip_data, mip_buffer_size));
+            mip_data += mip_buffer_size;
+            mip_data_size -= mip_buffer_size;
         }
     }
 }
 
 Decima::Texture::~Texture() {
-    for (const auto texture_id : mip_textures) {
-        glDeleteTextures(1, &texture_id);
-    }
+    /* Without a queue there's no render loop to delete them, i.e. the app is gone */
+    if (release_queue != nullptr)
+        release_queue->push(mip_textures);
 }
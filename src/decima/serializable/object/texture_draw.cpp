@@ -193,6 +193,16 @@ void Decima::Texture::draw() {
 }
 
 void Decima::Texture::draw_preview(float preview_width, float preview_height, float zoom_region, float zoom_scale) {
+    if (!textures_created) {
+        /* Mips in the stream are unpacked on the worker pool, and the preview waits for them without blocking the frame */
+        if (stream_size > 0 && external_data.data_async().wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ImGui::TextDisabled("Loading...");
+            return;
+        }
+
+        create_textures();
+    }
+
     if (mip_textures.empty()) {
         ImGui::TextDisabled("No preview available");
         return;
@@ -217,10 +227,15 @@ void Decima::Texture::draw_preview(float preview_width, float preview_height, fl
     const ImVec2 pos = ImGui::GetCursorScreenPos();
     const ImVec4 tint = { 1, 1, 1, 1 };
     const ImVec4 border = { 1, 1, 1, 1 };
+    if (mip_textures[mip_index] == 0) {
+        ImGui::TextDisabled("Data of this mip is not available");
+        return;
+    }
+
     ImGui::Image(reinterpret_cast<ImTextureID>(static_cast<std::size_t>(mip_textures[mip_index])), { preview_width, preview_height }, { 0, 0 }, { 1, 1 }, tint, border);
 
     if (ImGui::BeginPopupContextItem("Export Image")) {
-        if (ImGui::Selectable("Export image")) {
+        if (mip_textures[0] != 0 && ImGui::Selectable("Export image")) {
             auto full_path = pfd::save_file("Choose destination file", "", { "Truevision TGA (TARGA)", "*.tga" }).result();
 
             if (!full_path.empty()) {
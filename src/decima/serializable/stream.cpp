@@ -7,9 +7,48 @@ void Decima::Stream::parse(ArchiveManager& manager, ash::buffer& buffer, CoreFil
     buffer = buffer.skip(20);
     m_offs = buffer.get<decltype(m_offs)>();
     m_size = buffer.get<decltype(m_size)>();
+    m_manager = &manager;
+}
+
+/*
+ * Stream files are shared by many objects and may be hundreds of
+ * megabytes large, so only the range of this stream is unpacked.
+ */
+static ash::shared_buffer read_stream(Decima::ArchiveManager* manager, const std::string& name, std::uint32_t offset, std::uint32_t size) {
+    return manager != nullptr ? manager->read_range(name + ".core.stream", offset, size) : ash::shared_buffer();
+}
+
+const ash::shared_buffer& Decima::Stream::data() const {
+    /* Unless it was requested already, the range is unpacked right here rather than waiting for a worker */
+    std::call_once(m_data_requested, [this] {
+        std::promise<ash::shared_buffer> data;
+
+        try {
+            data.set_value(read_stream(m_manager, m_name.data(), m_offs, m_size));
+        } catch (...) {
+            data.set_exception(std::current_exception());
+        }
+
+        m_data = data.get_future().share();
+    });
+
+    return m_data.get();
+}
+
+std::shared_future<ash::shared_buffer> Decima::Stream::data_async() const {
+    if (m_manager == nullptr) {
+        data();
+        return m_data;
+    }
+
+    /* The task doesn't refer to the stream itself, since its object may be gone by the time it runs */
+    std::call_once(m_data_requested, [this] {
+        m_data = m_manager->workers->submit([manager = m_manager, name = m_name.data(), offset = m_offs, size = m_size] {
+            return read_stream(manager, name, offset, size);
+        }).share();
+    });
 
-    auto& stream_file = manager.query_file(m_name.data() + ".core.stream").value().get();
-    m_data = stream_file.contents;
+    return m_data;
 }
 
 void Decima::Stream::draw() {
@@ -17,6 +17,8 @@ void ProjectDS::begin_frame_user() {
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    /* Textures of objects that were destroyed since the last frame */
+    texture_release_queue->release();
 }
 
 void ProjectDS::end_frame_user() {
@@ -2,8 +2,12 @@
 // Created by i.getsman on 06.08.2020.
 //
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "projectds_app.hpp"
 
@@ -11,21 +15,35 @@
 #include "util/pfd.h"
 #include "utils.hpp"
 
+/* Oodle library is oo2core_X_win64.dll on Windows and liboo2coreX.so (possibly versioned) elsewhere */
+static bool is_compressor_library(const std::filesystem::path& path) {
+    const auto filename = path.filename().string();
+
+    if (filename.rfind("oo2core", 0) == 0)
+        return path.extension() == ".dll";
+
+    if (filename.rfind("liboo2core", 0) == 0)
+        return filename.find(".so") != std::string::npos;
+
+    return false;
+}
+
 static void show_data_selection_dialog(ProjectDS& self) {
     std::string folder = pfd::select_folder("Select game folder").result();
     std::string compressor_file;
 
     if (!folder.empty()) {
+        std::vector<std::string> archive_files;
+
         for (auto file : std::filesystem::recursive_directory_iterator(folder)) {
             auto filename = file.path().filename();
 
-            if (filename.extension() == ".dll" && filename.string().find("oo2core") == 0 && compressor_file.empty()) {
+            if (is_compressor_library(filename) && compressor_file.empty()) {
                 compressor_file = file.path().string();
             }
 
             if (filename.extension() == ".bin") {
-                DECIMA_LOG("Loading archive '", file.path().stem().string(), "'");
-                self.archive_manager.load_archive(file.path().string());
+                archive_files.push_back(file.path().string());
             }
         }
 
@@ -33,7 +51,7 @@ static void show_data_selection_dialog(ProjectDS& self) {
             DECIMA_LOG("Could not find compressor library");
 
             while (true) {
-                auto result = pfd::open_file("Select oo2core_X_win64.dll", "", { "oo2core_X_win64.dll", "oo2core_*_win64.dll" }).result();
+                auto result = pfd::open_file("Select oo2core_X_win64.dll or liboo2coreX.so", "", { "Oodle library", "oo2core_*_win64.dll liboo2core*.so*" }).result();
 
                 if (!result.empty()) {
                     compressor_file = result[0];
@@ -42,41 +60,84 @@ static void show_data_selection_dialog(ProjectDS& self) {
             }
         }
 
-        self.archive_manager.compressor = std::make_unique<Decima::Compressor>(compressor_file);
+        auto compressor = std::make_unique<Decima::OodleCompressor>(compressor_file);
 
-        DECIMA_LOG("Using compressor '", std::filesystem::path(compressor_file).filename().string(), "' (version ", self.archive_manager.compressor->get_version_string(), ")");
+        DECIMA_LOG("Using compressor '", std::filesystem::path(compressor_file).filename().string(), "' (version ", compressor->get_version_string(), ")");
 
-        if (self.archive_manager.compressor->get_version() < 0x2E070030) {
+        if (compressor->get_version() < 0x2E070030) {
             pfd::message("Unsupported compressor", "Compressor library version must be at least 2.7.0 (oo2core_7_win64) or greater", pfd::choice::ok, pfd::icon::error);
             std::exit(EXIT_FAILURE);
         }
 
-        self.archive_manager.load_prefetch();
+        self.archive_manager.compressor = std::move(compressor);
+
+        /*
+         * Archives named Patch*.bin override base archives, and
+         * are layered on top of each other in order of their names.
+         */
+        const auto is_patch_archive = [](const std::string& path) {
+            return std::filesystem::path(path).filename().string().rfind("Patch", 0) == 0;
+        };
+
+        std::sort(archive_files.begin(), archive_files.end());
+        std::stable_partition(archive_files.begin(), archive_files.end(), [&](const auto& path) { return !is_patch_archive(path); });
+
+        const auto first_patch_archive = std::find_if(archive_files.begin(), archive_files.end(), is_patch_archive);
+
+        /*
+         * Tables of all archives along with the prefetch are cached
+         * in a snapshot, which is rebuilt whenever any archive changes.
+         */
+        const auto snapshot_file = (std::filesystem::temp_directory_path() / ("projectds-" + uint64_to_hex(hash_string(folder, Decima::cipher_seed)) + ".snapshot")).string();
+
+        if (self.archive_manager.load_snapshot(snapshot_file, archive_files)) {
+            DECIMA_LOG("Loaded ", archive_files.size(), " archives from snapshot '", snapshot_file, "'");
+        } else {
+            DECIMA_LOG("Loading ", archive_files.size(), " archives");
+            self.archive_manager.load_archives({ archive_files.begin(), first_patch_archive });
+
+            for (auto patch_archive = first_patch_archive; patch_archive != archive_files.end(); patch_archive++)
+                self.archive_manager.load_archive(*patch_archive, static_cast<int>(patch_archive - first_patch_archive) + 1);
+
+            self.archive_manager.load_prefetch();
+
+            try {
+                self.archive_manager.save_snapshot(snapshot_file);
+            } catch (const std::exception& e) {
+                DECIMA_LOG("Snapshot could not be saved: ", e.what());
+            }
+        }
 
         self.file_names.clear();
         self.file_names.reserve(self.archive_manager.hash_to_name.size());
 
-        std::thread([](ProjectDS& self) {
-            self.root_tree_constructing = true;
+        for (const auto& [hash, path] : self.archive_manager.hash_to_name)
+            self.file_names.push_back(path.c_str());
 
-            for (const auto& [hash, path] : self.archive_manager.hash_to_name) {
-                self.file_names.push_back(path.c_str());
+        /*
+         * The tree is built off the UI thread into a separate
+         * instance and handed over once it's complete, so
+         * draw_tree never sees it half-constructed.
+         */
+        self.root_tree_future = std::async(std::launch::async, [&manager = self.archive_manager] {
+            FileTree root_tree;
 
+            for (const auto& [hash, path] : manager.hash_to_name) {
                 std::vector<std::string> split_path;
                 split(path, split_path, '/');
 
-                auto* current_root = &self.root_tree;
+                auto* current_root = &root_tree;
 
                 for (auto it = split_path.begin(); it != split_path.end() - 1; it++)
                     current_root = current_root->add_folder(*it);
 
-                if (self.archive_manager.hash_to_archive_index.find(hash) != self.archive_manager.hash_to_archive_index.end()) {
+                if (manager.file_index.find(hash) != nullptr) {
                     current_root->add_file(path, split_path.back(), hash, { 0 });
                 }
             }
 
-            self.root_tree_constructing = false;
-        }, std::ref(self)).detach();
+            return root_tree;
+        });
     }
 }
 
@@ -87,19 +148,47 @@ static void show_export_selection_dialog(ProjectDS& self) {
     const auto base_folder = pfd::select_folder("Choose destination folder").result();
 
     if (!base_folder.empty()) {
+        std::unordered_map<std::uint64_t, std::filesystem::path> paths;
+
         for (const auto selected_file : self.selection_info.selected_files) {
             const auto filename = sanitize_name(self.archive_manager.hash_to_name.at(selected_file));
 
             std::filesystem::path full_path = std::filesystem::path(base_folder) / filename;
             std::filesystem::create_directories(full_path.parent_path());
 
-            auto& file = self.archive_manager.query_file(filename).value().get();
+            paths.emplace(selected_file, std::move(full_path));
+        }
+
+        std::vector<std::uint64_t> hashes;
+        hashes.reserve(paths.size());
+
+        for (const auto& [hash, path] : paths)
+            hashes.push_back(hash);
+
+        std::mutex exported_mutex;
+        std::unordered_set<std::uint64_t> exported;
+
+        /* Files are written from the worker threads as soon as they are unpacked */
+        self.archive_manager.extract_files(hashes, [&](std::uint64_t hash, const ash::shared_buffer& contents) {
+            const auto& full_path = paths.at(hash);
 
             std::ofstream output_file { full_path, std::ios::binary };
-            output_file.write(reinterpret_cast<const char*>(file.contents.data()), file.contents.size());
+            output_file.write(contents.data(), contents.size());
+
+            std::lock_guard lock(exported_mutex);
+            exported.insert(hash);
+
+            std::cout << "File was exported to: " + full_path.string() + "\n";
+        });
 
-            std::cout << "File was exported to: " << full_path << "\n";
+        /* Files that are not in any of the loaded archives are never passed to the callback */
+        for (const auto& [hash, path] : paths) {
+            if (exported.find(hash) == exported.end())
+                std::cout << "File was not found in loaded archives: " + self.archive_manager.hash_to_name.at(hash) + "\n";
         }
+
+        if (exported.size() < paths.size())
+            pfd::message("Export", std::to_string(paths.size() - exported.size()) + " of " + std::to_string(paths.size()) + " files were not found in loaded archives and were not exported", pfd::choice::ok, pfd::icon::warning);
     }
 }
 
@@ -107,6 +196,7 @@ void ProjectDS::init_user() {
     App::init_user();
     init_imgui();
     init_filetype_handlers();
+    Decima::Texture::set_release_queue(texture_release_queue);
     ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
     file_viewer.WriteFn = [](auto, auto, auto) {
@@ -120,7 +210,7 @@ void ProjectDS::init_user() {
         GLFW_KEY_ESCAPE,
         ImGuiKeyModFlags_None,
         [&] {
-            if (selection_info.preview_file != 0) {
+            if (selection_info.preview_file != 0 && selection_info.file != nullptr) {
                 selection_info.preview_file_size = selection_info.file->contents.size();
                 selection_info.preview_file_offset = 0;
             }
@@ -347,7 +437,7 @@ void ProjectDS::draw_filepreview() {
                     ImGui::Text("Archive ID");
                     ImGui::NextColumn();
 
-                    ImGui::Text("%s", archive_manager.archives.at(archive_manager.hash_to_archive_index.at(selection_info.selected_file)).path.c_str());
+                    ImGui::Text("%s", archive_manager.archives.at(archive_manager.file_index.find(selection_info.selected_file)->archive).path.c_str());
                     ImGui::NextColumn();
 
                     ImGui::Separator();
@@ -387,11 +477,43 @@ void ProjectDS::draw_filepreview() {
                 const bool selected_file_changed = selection_info.preview_file != selection_info.selected_file;
 
                 if (selected_file_changed) {
-                    selection_info.file = &archive_manager.query_file(selection_info.selected_file).value().get();
-                    selection_info.file->parse();
+                    selection_info.file = nullptr;
+                    selection_info.file_error.clear();
+                    selection_info.objects.clear();
+                    selection_info.object_futures.clear();
+                    /* Only headers of objects are read here, objects themselves are parsed once they're shown */
+                    selection_info.file_future = archive_manager.workers->submit([&manager = archive_manager, hash = selection_info.selected_file] {
+                        auto file = manager.query_file(hash);
+
+                        if (file != nullptr)
+                            file->index_objects();
+
+                        return file;
+                    });
                     selection_info.preview_file = selection_info.selected_file;
-                    selection_info.preview_file_size = selection_info.file->contents.size();
-                    selection_info.preview_file_offset = 0;
+                }
+
+                if (selection_info.file_future.valid() && selection_info.file_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                    try {
+                        selection_info.file = selection_info.file_future.get();
+
+                        if (selection_info.file != nullptr) {
+                            selection_info.preview_file_size = selection_info.file->contents.size();
+                            selection_info.preview_file_offset = 0;
+                        } else {
+                            selection_info.file_error = "File is not present in loaded archives";
+                        }
+                    } catch (const std::exception& e) {
+                        DECIMA_LOG("Failed to load file: ", e.what());
+                        selection_info.file_error = e.what();
+                    }
+                }
+
+                if (selection_info.file == nullptr) {
+                    if (selection_info.file_error.empty())
+                        ImGui::TextDisabled("Loading...");
+                    else
+                        ImGui::TextDisabled("Failed to load file: %s", selection_info.file_error.c_str());
                 }
             } else {
                 ImGui::Text("Error getting file info!");
@@ -406,24 +528,58 @@ void ProjectDS::draw_filepreview() {
 
     ImGui::Begin("Normal View", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
     {
-        if (selection_info.selected_file > 0) {
-            for (const auto& [file, file_offset] : selection_info.file->objects) {
+        if (selection_info.selected_file > 0 && selection_info.file != nullptr) {
+            const auto& object_table = selection_info.file->index_objects();
+
+            for (std::size_t index = 0; index < object_table.size(); index++) {
+                const auto& info = object_table[index];
+
                 std::stringstream buffer;
-                buffer << '[' << Decima::to_string(file->guid) << "] " << Decima::get_type_name(file->header.file_type);
+                buffer << '[' << Decima::to_string(info.guid) << "] " << Decima::get_type_name(info.type);
 
                 const bool opened = ImGui::TreeNode(buffer.str().c_str());
 
                 if (ImGui::BeginPopupContextItem(buffer.str().c_str())) {
                     if (ImGui::Selectable("Highlight")) {
-                        selection_info.preview_file_offset = file_offset;
-                        selection_info.preview_file_size = file->header.file_size + sizeof(Decima::CoreHeader);
+                        selection_info.preview_file_offset = info.offset;
+                        selection_info.preview_file_size = info.size;
                     }
 
                     ImGui::EndPopup();
                 }
 
                 if (opened) {
-                    file->draw();
+                    /* Objects are parsed on the worker pool the first time they're shown, along with everything they reference */
+                    if (const auto object = selection_info.objects.find(index); object != selection_info.objects.end()) {
+                        if (object->second != nullptr)
+                            object->second->draw();
+                        else
+                            ImGui::TextDisabled("Failed to parse object");
+                    } else {
+                        auto& object_future = selection_info.object_futures[index];
+
+                        if (!object_future.valid()) {
+                            object_future = archive_manager.workers->submit([file = selection_info.file, index] {
+                                auto object = file->object(index);
+                                object->request_external_data();
+                                return object;
+                            });
+                        }
+
+                        if (object_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                            try {
+                                selection_info.objects.emplace(index, object_future.get());
+                            } catch (const std::exception& e) {
+                                DECIMA_LOG("Failed to parse object: ", e.what());
+                                selection_info.objects.emplace(index, nullptr);
+                            }
+
+                            selection_info.object_futures.erase(index);
+                        }
+
+                        ImGui::TextDisabled("Loading...");
+                    }
+
                     ImGui::TreePop();
                 }
 
@@ -435,9 +591,9 @@ void ProjectDS::draw_filepreview() {
 
     ImGui::Begin("Raw View", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
     {
-        if (selection_info.selected_file > 0) {
+        if (selection_info.selected_file > 0 && selection_info.file != nullptr) {
             file_viewer.DrawContents(
-                selection_info.file->contents.data() + selection_info.preview_file_offset,
+                const_cast<char*>(selection_info.file->contents.data()) + selection_info.preview_file_offset,
                 selection_info.preview_file_size,
                 0);
         }
@@ -462,10 +618,17 @@ void ProjectDS::draw_tree() {
             }
         }
 
-        if (root_tree_constructing) {
-            ImGui::PushStyleColor(ImGuiCol_Text, 0xff99ffff);
-            ImGui::TextWrapped("File tree is still constructing, some files may be missing");
-            ImGui::PopStyleColor();
+        if (root_tree_future.valid()) {
+            if (root_tree_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                root_tree = root_tree_future.get();
+
+                if (filter.IsActive())
+                    expand_mode = root_tree.apply_filter(filter);
+            } else {
+                ImGui::PushStyleColor(ImGuiCol_Text, 0xff99ffff);
+                ImGui::TextWrapped("File tree is still constructing");
+                ImGui::PopStyleColor();
+            }
         }
 
         ImGui::BeginChild("FileTree");